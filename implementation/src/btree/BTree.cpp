@@ -5,5 +5,5 @@
 // --------------------------------------------------------------------------
 using KEY = std::array<char, 24>;
 // --------------------------------------------------------------------------
-template class btree::BTree<KEY, std::array<char, 128>, 500, 4096>;
+template class btree::BTree<KEY, std::array<char, 128>, 4096>;
 // --------------------------------------------------------------------------
\ No newline at end of file
@@ -3,116 +3,275 @@
 // --------------------------------------------------------------------------
 #include "src/buffer/BufferManager.h"
 #include "src/buffer/DiskManager.h"
+#include "src/btree/Search.h"
+#include "src/heap/HeapFile.h"
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <functional>
 #include <mutex>
 #include <new>
 #include <optional>
 #include <iostream>
 #include <random>
+#include <ranges>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
 #include <vector>
 // --------------------------------------------------------------------------
 namespace btree {
 // --------------------------------------------------------------------------
-template <class KEY, size_t DEGREE>
-requires std::totally_ordered<KEY>
-struct Node {
+template <size_t SIZE>
+// child slot which is wider than a page id (for tuples stored inline); its
+// first bytes hold the id (or the swizzled pointer, or the sibling pointer of
+// a leaf)
+struct WideSlot {
+    uint64_t id;
+    std::array<char, SIZE - sizeof(uint64_t)> rest;
+
+    WideSlot() = default;
+    WideSlot(uint64_t id) : id(id) {}
+    operator uint64_t&() { return id; }
+    operator const uint64_t&() const { return id; }
+};
+// --------------------------------------------------------------------------
+template <size_t SIZE>
+using ChildSlot = std::conditional_t<SIZE == sizeof(uint64_t), uint64_t, WideSlot<SIZE>>;
+// --------------------------------------------------------------------------
+// trivially copyable tuples up to this size are stored inline in the leaf
+// slots (instead of a record in the heap file)
+static constexpr size_t MAX_INLINE_SIZE = 64;
+template <class DATA>
+static constexpr bool INLINE = std::is_trivially_copyable_v<DATA> && sizeof(DATA) <= MAX_INLINE_SIZE;
+// --------------------------------------------------------------------------
+template <class DATA>
+// size of the leaf slots; only the leaves are widened for inline tuples, the
+// inner nodes keep slots of page ids (and thus their fanout)
+static constexpr size_t SLOT_SIZE =
+    INLINE<DATA> ? (sizeof(DATA) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t) : sizeof(uint64_t);
+// --------------------------------------------------------------------------
+// header shared by leaves and inner nodes; the kind of a node is known from it
+struct NodeHeader {
     bool leaf;
     uint32_t keyAmount;
-    std::array<KEY, DEGREE> keys;
-    std::array<uint64_t, DEGREE + 1> children;
 };
 // --------------------------------------------------------------------------
-template <class KEY, size_t TOTAL_PAGE_SIZE>
-// there must be place for at least one key
-concept ValidPageSize =
-    TOTAL_PAGE_SIZE >= sizeof(buffer::Page<0>) + sizeof(Node<KEY, 0>) + sizeof(KEY) + 2 * sizeof(uint64_t);
+template <class KEY, size_t DEGREE, size_t SLOT_SIZE = sizeof(uint64_t)>
+requires std::totally_ordered<KEY>
+struct Node : NodeHeader {
+    std::array<KEY, DEGREE> keys;
+    std::array<ChildSlot<SLOT_SIZE>, DEGREE + 1> children;
+};
 // --------------------------------------------------------------------------
-template <class KEY, size_t TOTAL_PAGE_SIZE>
+template <class KEY, size_t TOTAL_PAGE_SIZE, size_t SLOT_SIZE = sizeof(uint64_t)>
 // maximal storage for (key,children) pairs = total - size of empty page - size of
 // empty node - the size of the last children
 static constexpr size_t DEGREE =
-    (TOTAL_PAGE_SIZE - sizeof(buffer::Page<0>) - sizeof(Node<KEY, 0>) - sizeof(uint64_t)) /
-    (sizeof(KEY) + sizeof(uint64_t));
+    (TOTAL_PAGE_SIZE - sizeof(buffer::Page<0>) - sizeof(Node<KEY, 0, SLOT_SIZE>) - SLOT_SIZE) /
+    (sizeof(KEY) + SLOT_SIZE);
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+// there must be place for at least one key in a leaf (inner nodes have
+// narrower slots, so they hold at least as many)
+concept ValidPageSize =
+    TOTAL_PAGE_SIZE >= sizeof(buffer::Page<0>) + sizeof(Node<KEY, 0, SLOT_SIZE<DATA>>) + SLOT_SIZE<DATA> &&
+    DEGREE<KEY, TOTAL_PAGE_SIZE, SLOT_SIZE<DATA>> >= 1;
+// --------------------------------------------------------------------------
+template <class KEY, size_t TOTAL_PAGE_SIZE>
+using InnerNode = Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>;
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+using LeafNode = Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE, SLOT_SIZE<DATA>>, SLOT_SIZE<DATA>>;
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
 class BTree {
     public:
+    using Inner = InnerNode<KEY, TOTAL_PAGE_SIZE>;
+    using Leaf = LeafNode<KEY, DATA, TOTAL_PAGE_SIZE>;
     // fit as much node slots as possible into each buffer page
-    static constexpr size_t PAGE_SIZE = sizeof(Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>);
-    static constexpr size_t DATA_PAGE_SIZE = sizeof(DATA);
-    static constexpr size_t KEYS_PER_NODE = DEGREE<KEY, TOTAL_PAGE_SIZE> - 1;
-    // page must fit in the provided memory
+    static constexpr size_t PAGE_SIZE = std::max(sizeof(Inner), sizeof(Leaf));
+    static constexpr bool INLINE_DATA = INLINE<DATA>;
+    // the leaf slot of a tuple either contains the tuple itself or its tid
+    using Slot = ChildSlot<SLOT_SIZE<DATA>>;
+    static constexpr size_t KEYS_PER_LEAF = DEGREE<KEY, TOTAL_PAGE_SIZE, SLOT_SIZE<DATA>> - 1;
+    static constexpr size_t KEYS_PER_INNER_NODE = DEGREE<KEY, TOTAL_PAGE_SIZE> - 1;
+    // nodes with less keys are merged with a sibling (if possible)
+    static constexpr size_t MIN_KEYS_PER_LEAF = DEGREE<KEY, TOTAL_PAGE_SIZE, SLOT_SIZE<DATA>> / 4;
+    static constexpr size_t MIN_KEYS_PER_INNER_NODE = DEGREE<KEY, TOTAL_PAGE_SIZE> / 4;
+    // share of the pages for the buffer of the heap file (the records
+    // outnumber the leaves by far)
+    static constexpr size_t HEAP_PERCENTAGE = INLINE_DATA ? 0 : 75;
+    // page must fit in the provided memory (also with wide slots)
     static_assert(TOTAL_PAGE_SIZE >= sizeof(buffer::Page<PAGE_SIZE>));
-    // nodes and data must be properly aligned (to be stored in frames)
-    static_assert(alignof(Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>) <= alignof(disk::Frame<PAGE_SIZE>));
-    static_assert(alignof(DATA) <= alignof(disk::Frame<PAGE_SIZE>));
+    // nodes must be properly aligned (to be stored in frames)
+    static_assert(alignof(Inner) <= alignof(disk::Frame<PAGE_SIZE>));
+    static_assert(alignof(Leaf) <= alignof(disk::Frame<PAGE_SIZE>));
 
     private:
 #ifdef LOGGING
     public:
     std::atomic<size_t> CONTENTION_SPLITS = 0;
+    std::atomic<size_t> OPTIMISTIC_RESTARTS = 0;
 #endif
     public:
     double d1 = 0.05;
     double d2 = 0.01;
     double d3 = 0.8;
+    // amount of optimistic descents before falling back to lock coupling
+    static constexpr size_t OPTIMISTIC_ATTEMPTS = 8;
+    // tag of swizzled child slots
+    static constexpr uint64_t SWIZZLED = uint64_t(1) << 63;
 
     const bool contentionSplitEnabled;
+    const bool optimisticReadsEnabled;
     // tree nodes
-    buffer::BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager;
-    // tuples
-    disk::DiskManager<sizeof(DATA)> diskManager;
+    buffer::BufferManager<PAGE_SIZE> bufferManager;
+    // tuples (only if they aren't stored inline)
+    std::optional<heap::HeapFile<>> heapFile;
     // b+-tree
     uint64_t root;
+    // amount of stored tuples
+    std::atomic<size_t> tupleAmount = 0;
 
     public:
-    BTree(const std::string&, const std::string&, bool, bool);
+    // the given amount of pages (and the maximal amount of the buffer
+    // configuration) is split among the buffers of the nodes and of the heap
+    // file; the data file is only used if the tuples aren't stored inline
+    BTree(const std::string&, const std::string&, size_t, bool, bool, bool optimisticReadsEnabled = true,
+          disk::IOConfig ioConfig = {}, buffer::Replacement replacement = buffer::Replacement::Clock,
+          buffer::BufferConfig bufferConfig = {});
 
     private:
-    void initializeNode(buffer::Page<PAGE_SIZE>&) const;
-    static Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>& getNode(buffer::Page<PAGE_SIZE>&);
-    static DATA& getData(disk::Frame<sizeof(DATA)>&);
-    size_t findChildrenIndex(Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>&, const KEY&) const;
+    // creates an empty leaf or inner node in the page
+    void initializeNode(buffer::Page<PAGE_SIZE>&, bool leaf = true) const;
+    // the kind of a node has to be checked with its header before it is
+    // accessed as leaf or inner node
+    static NodeHeader& getHeader(buffer::Page<PAGE_SIZE>&);
+    static Leaf& getLeaf(buffer::Page<PAGE_SIZE>&);
+    static Inner& getInner(buffer::Page<PAGE_SIZE>&);
+    // the child slots of inner nodes either contain the id of the child or,
+    // while it is in memory, a tagged pointer to its page
+    static bool isSwizzled(uint64_t);
+    static buffer::Page<PAGE_SIZE>* toPage(uint64_t);
+    // the node of the slot must be latched
+    static uint64_t toID(uint64_t);
+    // pins the child of a latched node
+    buffer::Page<PAGE_SIZE>* pinChild(uint64_t);
+    // stores a pointer to the pinned child in the slot; the parent must be
+    // locked exclusively
+    static void swizzle(buffer::Page<PAGE_SIZE>&, uint64_t&, buffer::Page<PAGE_SIZE>&);
+    static void unswizzleSlot(uint64_t&);
+    // required before slots are moved to another node
+    static void unswizzleAll(Inner&);
+    Slot createTuple(DATA);
+    DATA readTuple(const Slot&);
+    // returns whether the slot (and thus the leaf) was modified
+    bool updateTuple(Slot&, const std::function<void(DATA&)>&);
+    void deleteTuple(const Slot&);
+    // not thread safe
+    size_t countTuples();
+    // amount of entries per node of the given capacity for the fill factor of
+    // a bulk load
+    static size_t fillAmount(double, size_t);
+    // writes the level above the given (first key, id) pairs of nodes; the
+    // top level is written into the root page
+    std::vector<std::pair<KEY, uint64_t>> buildInnerLevel(const std::vector<std::pair<KEY, uint64_t>>&, double);
+    template <class NODE>
+    size_t findChildrenIndex(NODE&, const KEY&) const;
+    // position of the key inside a leaf (if it is stored there)
+    std::optional<size_t> findKeyIndex(Leaf&, const KEY&) const;
     // node n will be split into left (new) and right (n); where the key at
     // index i will be stored in the right one
-    uint64_t split(Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>&, size_t);
-    void simpleInsert(Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>&, size_t, KEY, uint64_t) const;
+    template <class NODE>
+    uint64_t split(NODE&, size_t);
+    // leaf n will be split into left (n) and right (new); the key at index i
+    // will be the first one of the right leaf, which keeps n's sibling pointer
+    uint64_t splitLeaf(Leaf&, size_t);
+    template <class NODE, class CHILD>
+    void simpleInsert(NODE&, size_t, KEY, CHILD) const;
     // returns (tried, success); assumes that the parent is shared and
     // the child is locked exclusively
     std::pair<bool, bool> tryContentionSplit(buffer::Page<PAGE_SIZE>&,
                                              buffer::Page<PAGE_SIZE>&, bool, size_t, const KEY&);
     void insert(uint64_t, KEY, DATA);
+    // removes the key (and its tuple) from the leaf; returns whether it was found
+    bool eraseFromLeaf(Leaf&, const KEY&);
+    // merges the child at index i with a sibling if it is underfull (or moves
+    // an entry of the sibling to it if they don't fit into one node); assumes
+    // that the parent is locked exclusively; freed pages are appended; returns
+    // whether the parent was modified
+    bool tryMerge(Inner&, size_t, std::vector<uint64_t>&);
+    // merges or rebalances the latched siblings (children leftIndex and
+    // leftIndex + 1 of the parent); the child is the underfull one of them
+    template <bool LEAF>
+    bool mergeSiblings(Inner&, size_t, buffer::Page<PAGE_SIZE>&, buffer::Page<PAGE_SIZE>&,
+                       const buffer::Page<PAGE_SIZE>&, std::vector<uint64_t>&);
+    // exclusive descent (like insert) which erases the key if requested and
+    // merges the children which became underfull on the way back up; returns
+    // whether it was found and sets whether the node itself is underfull
+    bool erase(uint64_t, const KEY&, bool, std::vector<uint64_t>&, bool&);
+    // descends to the leaf of the key without locking the inner nodes (their
+    // versions are validated instead); on success, the leaf is pinned and
+    // shared, as well as its parent if requested (and existent)
+    bool optimisticDescend(const KEY&, bool, buffer::Page<PAGE_SIZE>*&, buffer::Page<PAGE_SIZE>*&);
+    // returns the pinned and shared leaf which may contain the key
+    buffer::Page<PAGE_SIZE>* findLeaf(const KEY&);
 
     public:
     static bool isInnerNode(buffer::Page<PAGE_SIZE>*);
+    // checks whether a child of the claimed node is in memory
+    static bool hasResidentChildren(buffer::Page<PAGE_SIZE>*, const buffer::PageTable&);
+    // called by the buffer manager before the page is evicted
+    static void unswizzle(buffer::Page<PAGE_SIZE>*);
     static bool tryXMerge(uint64_t,
-                          std::unordered_map<uint64_t, size_t>&,
+                          buffer::PageTable&,
                           std::unordered_set<uint64_t>&,
-                          std::array<std::unique_ptr<buffer::Page<PAGE_SIZE>>, PAGE_AMOUNT>&,
+                          buffer::PageArena<PAGE_SIZE>&,
                           disk::DiskManager<PAGE_SIZE>&);
     size_t size() const;
+    // splits the given bytes among both buffers like the pages on construction
+    void setMemoryBudget(size_t);
     std::optional<DATA> find(const KEY&);
     void insert(KEY, DATA);
+    // builds the tree bottom-up from (key, data) pairs sorted by key; nodes
+    // are filled up to the given fraction; the tree must be empty; not thread
+    // safe
+    template <std::ranges::forward_range RANGE>
+    void bulkLoad(const RANGE&, double fillFactor = 1.0);
     bool contains(const KEY&);
     bool update(const KEY&, const std::function<void(DATA&)>&);
+    bool erase(const KEY&);
+    // calls the function for (at most) the given amount of tuples in key order,
+    // starting at the first key not less than the given one; the function must
+    // not access the tree; returns the amount of scanned tuples
+    size_t scan(const KEY&, size_t, const std::function<void(const KEY&, const DATA&)>&);
     // not thread safe
     void print(uint64_t, bool);
 };
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::BTree(
-    const std::string& treePath, const std::string& dataPath, bool contentionSplitEnabled, bool xMergeEnabled)
-    : contentionSplitEnabled(contentionSplitEnabled),
-      bufferManager(treePath, !xMergeEnabled ? nullptr : tryXMerge, isInnerNode),
-      diskManager(dataPath), root(0) {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+BTree<KEY, DATA, TOTAL_PAGE_SIZE>::BTree(
+    const std::string& treePath, const std::string& dataPath, size_t pageAmount, bool contentionSplitEnabled,
+    bool xMergeEnabled, bool optimisticReadsEnabled, disk::IOConfig ioConfig, buffer::Replacement replacement,
+    buffer::BufferConfig bufferConfig)
+    : contentionSplitEnabled(contentionSplitEnabled), optimisticReadsEnabled(optimisticReadsEnabled),
+      bufferManager(treePath, pageAmount - pageAmount * HEAP_PERCENTAGE / 100, !xMergeEnabled ? nullptr : tryXMerge,
+                    isInnerNode, unswizzle, ioConfig, replacement, hasResidentChildren,
+                    {.maxFrames = bufferConfig.maxFrames - bufferConfig.maxFrames * HEAP_PERCENTAGE / 100,
+                     .backgroundWriter = bufferConfig.backgroundWriter}),
+      root(0) {
+    if constexpr (!INLINE_DATA) {
+        heapFile.emplace(dataPath, pageAmount * HEAP_PERCENTAGE / 100, ioConfig, replacement,
+                         buffer::BufferConfig{.maxFrames = bufferConfig.maxFrames * HEAP_PERCENTAGE / 100,
+                                              .backgroundWriter = bufferConfig.backgroundWriter});
+    }
     // the tree always contains at least a root node
     if (bufferManager.totalFrames() == 0) {
         root = bufferManager.newPage();
@@ -121,59 +280,259 @@ BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::BTree(
             ;
         initializeNode(*page);
         bufferManager.unpinPage(root, true);
+    } else {
+        tupleAmount = countTuples();
     }
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::initializeNode(buffer::Page<PAGE_SIZE>& page) const {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::initializeNode(buffer::Page<PAGE_SIZE>& page, bool leaf) const {
     // create a new node using placement new
-    auto* node = new (page.frame.content.data()) Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>;
-    node->leaf = true;
-    node->keyAmount = 0;
+    if (leaf) {
+        auto* node = new (page.frame.content.data()) Leaf;
+        node->leaf = true;
+        node->keyAmount = 0;
+        // the root terminates the leaf chain (it is never the right sibling of a leaf)
+        node->children[0] = root;
+    } else {
+        auto* node = new (page.frame.content.data()) Inner;
+        node->leaf = false;
+        node->keyAmount = 0;
+    }
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-    Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>
-&BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::getNode(buffer::Page<PAGE_SIZE>& page) {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+NodeHeader& BTree<KEY, DATA, TOTAL_PAGE_SIZE>::getHeader(buffer::Page<PAGE_SIZE>& page) {
     // reinterpret the content (defined behaviour since the frame and its data array are properly aligned)
-    auto* ptr = reinterpret_cast<Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>*>(page.frame.content.data());
-    return *ptr;
+    return *reinterpret_cast<NodeHeader*>(page.frame.content.data());
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-    DATA& BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::getData(disk::Frame<sizeof(DATA)>& frame) {
-    // reinterpret the content (defined behaviour since the frame and its data array are properly aligned)
-    auto* ptr = reinterpret_cast<DATA*>(frame.content.data());
-    return *ptr;
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+typename BTree<KEY, DATA, TOTAL_PAGE_SIZE>::Leaf&
+BTree<KEY, DATA, TOTAL_PAGE_SIZE>::getLeaf(buffer::Page<PAGE_SIZE>& page) {
+    return *reinterpret_cast<Leaf*>(page.frame.content.data());
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-size_t BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::findChildrenIndex(
-    Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>& node, const KEY& key) const {
-    for (size_t i = 0; i < node.keyAmount; i++) {
-        if (key < node.keys[i]) {
-            return i;
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+typename BTree<KEY, DATA, TOTAL_PAGE_SIZE>::Inner&
+BTree<KEY, DATA, TOTAL_PAGE_SIZE>::getInner(buffer::Page<PAGE_SIZE>& page) {
+    return *reinterpret_cast<Inner*>(page.frame.content.data());
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::isSwizzled(uint64_t slot) {
+    // page ids never reach the highest bit
+    return slot & SWIZZLED;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+buffer::Page<BTree<KEY, DATA, TOTAL_PAGE_SIZE>::PAGE_SIZE>*
+BTree<KEY, DATA, TOTAL_PAGE_SIZE>::toPage(uint64_t slot) {
+    assert(isSwizzled(slot));
+    return reinterpret_cast<buffer::Page<PAGE_SIZE>*>(slot & ~SWIZZLED);
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+uint64_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::toID(uint64_t slot) {
+    return isSwizzled(slot) ? toPage(slot)->id : slot;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+buffer::Page<BTree<KEY, DATA, TOTAL_PAGE_SIZE>::PAGE_SIZE>*
+BTree<KEY, DATA, TOTAL_PAGE_SIZE>::pinChild(uint64_t slot) {
+    buffer::Page<PAGE_SIZE>* page;
+    if (isSwizzled(slot)) {
+        // it can't be evicted while the parent is latched, but the buffer
+        // manager might claim it for a moment
+        page = toPage(slot);
+        while (!bufferManager.pinPage(*page)) {
+            std::this_thread::yield();
+        }
+        return page;
+    }
+    while (!(page = bufferManager.pinPage(slot, true)))
+        ;
+    return page;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::swizzle(
+    buffer::Page<PAGE_SIZE>& parent, uint64_t& slot, buffer::Page<PAGE_SIZE>& child) {
+    assert(child.pinned > 0);
+    if (isSwizzled(slot)) {
+        return;
+    }
+    assert(slot == child.id && !child.swizzledBy);
+    child.swizzledBy = &parent;
+    parent.swizzledChildren++;
+    slot = reinterpret_cast<uint64_t>(&child) | SWIZZLED;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::unswizzleSlot(uint64_t& slot) {
+    if (!isSwizzled(slot)) {
+        return;
+    }
+    buffer::Page<PAGE_SIZE>* child = toPage(slot);
+    buffer::Page<PAGE_SIZE>* parent = child->swizzledBy;
+    assert(parent && parent->swizzledChildren > 0);
+    slot = child->id;
+    child->swizzledBy = nullptr;
+    parent->swizzledChildren--;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::unswizzleAll(Inner& node) {
+    assert(!node.leaf);
+    for (size_t i = 0; i <= node.keyAmount; i++) {
+        unswizzleSlot(node.children[i]);
+    }
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::unswizzle(buffer::Page<PAGE_SIZE>* page) {
+    auto& parentNode = getInner(*page->swizzledBy);
+    const uint64_t slot = reinterpret_cast<uint64_t>(page) | SWIZZLED;
+    for (size_t i = 0; i <= parentNode.keyAmount; i++) {
+        if (parentNode.children[i] == slot) {
+            unswizzleSlot(parentNode.children[i]);
+            return;
+        }
+    }
+    assert(false);
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+typename BTree<KEY, DATA, TOTAL_PAGE_SIZE>::Slot BTree<KEY, DATA, TOTAL_PAGE_SIZE>::createTuple(DATA data) {
+    if constexpr (INLINE_DATA) {
+        Slot slot{};
+        std::memcpy(&slot, &data, sizeof(DATA));
+        return slot;
+    } else {
+        return heapFile->insert(heap::Serializer<DATA>::toBytes(data));
+    }
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+DATA BTree<KEY, DATA, TOTAL_PAGE_SIZE>::readTuple(const Slot& slot) {
+    if constexpr (INLINE_DATA) {
+        DATA data;
+        std::memcpy(&data, &slot, sizeof(DATA));
+        return data;
+    } else {
+        std::optional<DATA> data;
+        heapFile->read(slot, [&data](std::string_view bytes) {
+            data = heap::Serializer<DATA>::fromBytes(bytes);
+        });
+        return std::move(*data);
+    }
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::updateTuple(
+    Slot& slot, const std::function<void(DATA&)>& func) {
+    if constexpr (INLINE_DATA) {
+        DATA data = readTuple(slot);
+        func(data);
+        slot = createTuple(std::move(data));
+        return true;
+    } else {
+        DATA data = readTuple(slot);
+        func(data);
+        // the record moves if it grew too much for its page
+        const uint64_t tid = heapFile->update(slot, heap::Serializer<DATA>::toBytes(data));
+        const bool moved = tid != slot;
+        slot = tid;
+        return moved;
+    }
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::deleteTuple(const Slot& slot) {
+    if constexpr (!INLINE_DATA) {
+        heapFile->erase(slot);
+    }
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+size_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::countTuples() {
+    // descend to the leftmost leaf
+    uint64_t id = root;
+    while (true) {
+        buffer::Page<PAGE_SIZE>* page;
+        while (!(page = bufferManager.pinPage(id, true)))
+            ;
+        if (getHeader(*page).leaf) {
+            bufferManager.unpinPage(id, false);
+            break;
         }
+        const uint64_t childID = toID(getInner(*page).children[0]);
+        bufferManager.unpinPage(id, false);
+        id = childID;
+    }
+    // follow the leaf chain
+    size_t amount = 0;
+    do {
+        buffer::Page<PAGE_SIZE>* page;
+        while (!(page = bufferManager.pinPage(id, true)))
+            ;
+        auto& node = getLeaf(*page);
+        amount += node.keyAmount;
+        const uint64_t nextID = node.children[node.keyAmount];
+        bufferManager.unpinPage(id, false);
+        id = nextID;
+    } while (id != root);
+    return amount;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+template <class NODE>
+size_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::findChildrenIndex(NODE& node, const KEY& key) const {
+    // optimistic readers may see a torn key amount; they validate the
+    // result, but must not read beyond the node meanwhile
+    const size_t keyAmount = std::min<size_t>(node.keyAmount, node.keys.size());
+    return upperBound(node.keys.data(), keyAmount, key);
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+std::optional<size_t> BTree<KEY, DATA, TOTAL_PAGE_SIZE>::findKeyIndex(Leaf& node, const KEY& key) const {
+    const size_t index = lowerBound(node.keys.data(), node.keyAmount, key);
+    if (index < node.keyAmount && node.keys[index] == key) {
+        return index;
     }
-    return node.keyAmount;
+    return std::nullopt;
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-uint64_t BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::split(
-    Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>& node, size_t index) {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+template <class NODE>
+uint64_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::split(NODE& node, size_t index) {
     // create a new page
     const uint64_t leftID = bufferManager.newPage();
     buffer::Page<PAGE_SIZE>* leftPage;
     while (!(leftPage = bufferManager.pinPage(leftID)))
         ;
-    initializeNode(*leftPage);
-    auto& leftNode = getNode(*leftPage);
-    leftNode.leaf = node.leaf;
+    initializeNode(*leftPage, node.leaf);
+    auto& leftNode = *reinterpret_cast<NODE*>(leftPage->frame.content.data());
     // treat the left node as right node
     // move keys and pointers to the right node
     std::move(std::begin(node.keys) + index, std::end(node.keys), std::begin(leftNode.keys));
@@ -184,28 +543,55 @@ uint64_t BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::split(
     assert(node.keyAmount <= node.keys.size());
     // swap the nodes
     std::swap(node, leftNode);
+    if (!leftNode.leaf) {
+        bufferManager.setInnerNode(leftID, true);
+    }
     bufferManager.unpinPage(leftID, true);
     return leftID;
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::
-    simpleInsert(Node<KEY, DEGREE<KEY, TOTAL_PAGE_SIZE>>& node, size_t index, KEY key, uint64_t id) const {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+uint64_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::splitLeaf(Leaf& node, size_t index) {
+    assert(node.leaf);
+    // create a new page
+    const uint64_t rightID = bufferManager.newPage();
+    buffer::Page<PAGE_SIZE>* rightPage;
+    while (!(rightPage = bufferManager.pinPage(rightID)))
+        ;
+    initializeNode(*rightPage);
+    auto& rightNode = getLeaf(*rightPage);
+    // move keys and data pointers (including the sibling pointer) to the right node
+    std::move(std::begin(node.keys) + index, std::begin(node.keys) + node.keyAmount, std::begin(rightNode.keys));
+    std::move(std::begin(node.children) + index, std::begin(node.children) + node.keyAmount + 1,
+              std::begin(rightNode.children));
+    rightNode.keyAmount = node.keyAmount - index;
+    node.keyAmount = index;
+    // link the left node to the right one; a left neighbour of n still points
+    // to n, so the leaves stay chained
+    node.children[node.keyAmount] = rightID;
+    bufferManager.unpinPage(rightID, true);
+    return rightID;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+template <class NODE, class CHILD>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::simpleInsert(NODE& node, size_t index, KEY key, CHILD slot) const {
     // move all greater entries to the right
     assert(index < node.keys.size());
     std::move(std::begin(node.keys) + index, std::end(node.keys) - 1, std::begin(node.keys) + index + 1);
     std::move(std::begin(node.children) + index, std::end(node.children) - 1, std::begin(node.children) + index + 1);
     // insert
     node.keys[index] = std::move(key);
-    node.children[index] = id;
+    node.children[index] = std::move(slot);
     node.keyAmount++;
     assert(node.keyAmount <= node.keys.size());
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-std::pair<bool, bool> BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+std::pair<bool, bool> BTree<KEY, DATA, TOTAL_PAGE_SIZE>::
     tryContentionSplit(buffer::Page<PAGE_SIZE>& parentPage, buffer::Page<PAGE_SIZE>& currentPage,
                        bool fastPath, size_t index, const KEY& key) {
     if (!contentionSplitEnabled || currentPage.id == root) {
@@ -227,7 +613,7 @@ std::pair<bool, bool> BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::
         // found contention on two different indexes
         double ratio = currentPage.slowPaths / static_cast<double>(currentPage.updates);
         if (ratio > d3 && lastUpdate != index) {
-            auto& parentNode = getNode(parentPage);
+            auto& parentNode = getInner(parentPage);
             const size_t keyAmount = parentNode.keyAmount;
             if (keyAmount < parentNode.keys.size() - 1) {
                 contentionSplitAttempt = true;
@@ -237,19 +623,25 @@ std::pair<bool, bool> BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::
                 parentPage.mutex.lock();
                 currentPage.mutex.lock();
                 // check if the contention still exists
-                auto& currentNode = getNode(currentPage);
+                auto& currentNode = getLeaf(currentPage);
                 const size_t currentIndex = findChildrenIndex(parentNode, key);
                 const size_t midIndex = (lastUpdate + index + 1) / 2;
                 assert(currentNode.leaf);
+                // (the leaf may have been split in the meantime; slots beyond
+                // the key amount still hold stale keys)
                 if (midIndex < currentNode.keyAmount &&
+                    index < currentNode.keyAmount &&
                     parentNode.keyAmount > 0 &&
                     parentNode.keyAmount < parentNode.keys.size() &&
-                    currentNode.keys[index] == key) {
+                    currentNode.keys[index] == key &&
+                    toID(parentNode.children[currentIndex]) == currentPage.id) {
                     // split
-                    uint64_t leftID = split(currentNode, midIndex);
-                    // childnode -[split]-> leftNode, childnode
-                    currentNode.children[currentNode.keyAmount] = leftID;
-                    simpleInsert(parentNode, currentIndex, currentNode.keys[0], leftID);
+                    KEY midKey = currentNode.keys[midIndex];
+                    const uint64_t rightID = splitLeaf(currentNode, midIndex);
+                    // childnode -[split]-> childnode, rightNode (the slot of
+                    // the child may be swizzled)
+                    simpleInsert(parentNode, currentIndex, std::move(midKey), parentNode.children[currentIndex]);
+                    parentNode.children[currentIndex + 1] = rightID;
                     contentionSplit = true;
                     assert(parentNode.keyAmount <= parentNode.keys.size());
 #ifdef LOGGING
@@ -267,25 +659,19 @@ std::pair<bool, bool> BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::
 }
 
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key, DATA data) {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key, DATA data) {
     buffer::Page<PAGE_SIZE>* page;
     while (!(page = bufferManager.pinPage(id, true)))
         ;
     // get lock on node
     std::unique_lock lock(page->mutex);
-    auto& node = getNode(*page);
-    assert(node.keyAmount < node.keys.size());
-    size_t index = findChildrenIndex(node, key);
-    if (node.leaf) {
+    if (getHeader(*page).leaf) {
+        auto& node = getLeaf(*page);
         assert(node.keyAmount < node.keys.size());
-        // create a new data frame
-        auto [newID, frame] = std::move(diskManager.createPage());
-        getData(frame) = std::move(data);
-        diskManager.writePage(newID, std::move(frame));
         // insert into node
-        simpleInsert(node, index, std::move(key), newID);
+        simpleInsert(node, findChildrenIndex(node, key), std::move(key), createTuple(std::move(data)));
         // special case: root is leaf + overflow
         if (id == root && node.keyAmount == node.keys.size()) {
             // save key
@@ -296,7 +682,7 @@ void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key
             buffer::Page<PAGE_SIZE>* leftPage;
             while (!(leftPage = bufferManager.pinPage(leftID, true)))
                 ;
-            auto& leftNode = getNode(*leftPage);
+            auto& leftNode = getLeaf(*leftPage);
             // set pointer
             leftNode.children[leftNode.keyAmount] = newRightID;
             bufferManager.unpinPage(leftID, true);
@@ -306,48 +692,59 @@ void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key
             while (!(newRightPage = bufferManager.pinPage(newRightID)))
                 ;
             initializeNode(*newRightPage);
-            auto& newRightNode = getNode(*newRightPage);
-            // swap root and the new right node
-            std::swap(newRightNode, node);
+            // move the root leaf to the new right node
+            getLeaf(*newRightPage) = node;
             bufferManager.unpinPage(newRightID, true);
             // now, insert left and newRight into the root
-            node.leaf = false;
-            node.keyAmount = 1;
-            node.keys[0] = std::move(midKey);
-            node.children[0] = leftID;
-            node.children[1] = newRightID;
+            initializeNode(*page, false);
+            auto& rootNode = getInner(*page);
+            rootNode.keyAmount = 1;
+            rootNode.keys[0] = std::move(midKey);
+            rootNode.children[0] = leftID;
+            rootNode.children[1] = newRightID;
+            bufferManager.setInnerNode(root, true);
         }
         lock.unlock();
         bufferManager.unpinPage(id, true);
         return;
     }
-    uint64_t childID = node.children[index];
+    auto& node = getInner(*page);
+    assert(node.keyAmount < node.keys.size());
+    const size_t index = findChildrenIndex(node, key);
+    uint64_t childID = toID(node.children[index]);
     assert(id != childID);
     // find child and insert
     insert(childID, std::move(key), std::move(data));
     // now check for overflow
-    buffer::Page<PAGE_SIZE>* childPage;
-    while (!(childPage = bufferManager.pinPage(childID, true)))
-        ;
+    buffer::Page<PAGE_SIZE>* childPage = pinChild(node.children[index]);
     // get lock on child
     std::unique_lock childLock(childPage->mutex);
-    auto& childNode = getNode(*childPage);
-    // overflow occurred
-    if (childNode.keyAmount == childNode.keys.size()) {
-        // split
-        const uint64_t leftID = split(childNode, childNode.keys.size() / 2);
-        // childnode -[split]-> leftNode, childnode
-        if (childNode.leaf) {
-            // set the pointer
-            childNode.children[childNode.keyAmount] = leftID;
-            // insert
+    bool overflow = false;
+    if (getHeader(*childPage).leaf) {
+        auto& childNode = getLeaf(*childPage);
+        overflow = childNode.keyAmount == childNode.keys.size();
+        if (overflow) {
+            // split
+            KEY midKey = childNode.keys[childNode.keys.size() / 2];
+            const uint64_t rightID = splitLeaf(childNode, childNode.keys.size() / 2);
+            // childnode -[split]-> childnode, rightNode (keeping the slot of the child)
             assert(node.keyAmount < node.keys.size());
-            simpleInsert(node, index, childNode.keys[0], leftID);
-        } else {
+            simpleInsert(node, index, std::move(midKey), node.children[index]);
+            node.children[index + 1] = rightID;
+        }
+    } else {
+        auto& childNode = getInner(*childPage);
+        overflow = childNode.keyAmount == childNode.keys.size();
+        if (overflow) {
+            // the children are moved to other nodes
+            unswizzleAll(childNode);
+            // split
+            const uint64_t leftID = split(childNode, childNode.keys.size() / 2);
+            // childnode -[split]-> leftNode, childnode
             buffer::Page<PAGE_SIZE>* leftPage;
             while (!(leftPage = bufferManager.pinPage(leftID, true)))
                 ;
-            auto& leftNode = getNode(*leftPage);
+            auto& leftNode = getInner(*leftPage);
             leftNode.children[leftNode.keyAmount] = childNode.children[0];
             bufferManager.unpinPage(leftID, true);
             KEY midKey = std::move(childNode.keys[0]);
@@ -360,16 +757,21 @@ void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key
             simpleInsert(node, index, std::move(midKey), leftID);
         }
     }
+    if (!overflow) {
+        // the next descent can skip the page table
+        swizzle(*page, node.children[index], *childPage);
+    }
     childLock.unlock();
-    bufferManager.unpinPage(childID, true);
+    bufferManager.unpinPage(*childPage, true);
     // special case: root overflow
     if (id == root && node.keyAmount == node.keys.size()) {
+        unswizzleAll(node);
         // split
         const uint64_t leftID = split(node, node.keys.size() / 2);
         buffer::Page<PAGE_SIZE>* leftPage;
         while (!(leftPage = bufferManager.pinPage(leftID, true)))
             ;
-        auto& leftNode = getNode(*leftPage);
+        auto& leftNode = getInner(*leftPage);
         leftNode.children[leftNode.keyAmount] = node.children[0];
         bufferManager.unpinPage(leftID, true);
         // save key
@@ -383,10 +785,11 @@ void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key
         buffer::Page<PAGE_SIZE>* newRightPage;
         while (!(newRightPage = bufferManager.pinPage(newRightID)))
             ;
-        initializeNode(*newRightPage);
-        auto& newRightNode = getNode(*newRightPage);
+        initializeNode(*newRightPage, false);
+        auto& newRightNode = getInner(*newRightPage);
         // swap root and the new right node
         std::swap(newRightNode, node);
+        bufferManager.setInnerNode(newRightID, true);
         bufferManager.unpinPage(newRightID, true);
         // now, insert left and newRight into the root
         node.leaf = false;
@@ -399,24 +802,390 @@ void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(uint64_t id, KEY key
     bufferManager.unpinPage(id, true);
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::isInnerNode(
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::eraseFromLeaf(Leaf& node, const KEY& key) {
+    assert(node.leaf);
+    const std::optional<size_t> index = findKeyIndex(node, key);
+    if (!index) {
+        return false;
+    }
+    const size_t i = *index;
+    const Slot slot = node.children[i];
+    // move all greater entries (and the sibling pointer) to the left
+    std::move(std::begin(node.keys) + i + 1, std::begin(node.keys) + node.keyAmount, std::begin(node.keys) + i);
+    std::move(std::begin(node.children) + i + 1, std::begin(node.children) + node.keyAmount + 1,
+              std::begin(node.children) + i);
+    node.keyAmount--;
+    deleteTuple(slot);
+    return true;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::tryMerge(Inner& node, size_t index, std::vector<uint64_t>& freedPages) {
+    if (node.keyAmount == 0) {
+        // no sibling
+        return false;
+    }
+    buffer::Page<PAGE_SIZE>* childPage = pinChild(node.children[index]);
+    childPage->mutex.lock();
+    const NodeHeader& childHeader = getHeader(*childPage);
+    const bool leaf = childHeader.leaf;
+    if (childHeader.keyAmount >= (leaf ? MIN_KEYS_PER_LEAF : MIN_KEYS_PER_INNER_NODE)) {
+        childPage->mutex.unlock();
+        bufferManager.unpinPage(*childPage, false);
+        return false;
+    }
+    // merge the right one of (index, index + 1) or (index - 1, index) into the
+    // left one; siblings are always locked from left to right (like in scans)
+    const size_t leftIndex = index < node.keyAmount ? index : index - 1;
+    buffer::Page<PAGE_SIZE>* leftPage = childPage;
+    buffer::Page<PAGE_SIZE>* rightPage;
+    if (leftIndex == index) {
+        rightPage = pinChild(node.children[leftIndex + 1]);
+        rightPage->mutex.lock();
+    } else {
+        childPage->mutex.unlock();
+        rightPage = childPage;
+        leftPage = pinChild(node.children[leftIndex]);
+        leftPage->mutex.lock();
+        rightPage->mutex.lock();
+    }
+    assert(getHeader(*leftPage).leaf == getHeader(*rightPage).leaf);
+    const bool modified = leaf ? mergeSiblings<true>(node, leftIndex, *leftPage, *rightPage, *childPage, freedPages)
+                               : mergeSiblings<false>(node, leftIndex, *leftPage, *rightPage, *childPage, freedPages);
+    rightPage->mutex.unlock();
+    leftPage->mutex.unlock();
+    bufferManager.unpinPage(*rightPage, modified);
+    bufferManager.unpinPage(*leftPage, modified);
+    return modified;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+template <bool LEAF>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::mergeSiblings(Inner& node, size_t leftIndex,
+                                                      buffer::Page<PAGE_SIZE>& leftPage,
+                                                      buffer::Page<PAGE_SIZE>& rightPage,
+                                                      const buffer::Page<PAGE_SIZE>& childPage,
+                                                      std::vector<uint64_t>& freedPages) {
+    // (the layouts of both kinds coincide if the leaf slots aren't widened)
+    using NODE = std::conditional_t<LEAF, Leaf, Inner>;
+    constexpr size_t MIN_KEYS = LEAF ? MIN_KEYS_PER_LEAF : MIN_KEYS_PER_INNER_NODE;
+    auto& leftNode = *reinterpret_cast<NODE*>(leftPage.frame.content.data());
+    auto& rightNode = *reinterpret_cast<NODE*>(rightPage.frame.content.data());
+    // inner nodes additionally take the separator of the parent
+    const size_t mergedKeys = leftNode.keyAmount + rightNode.keyAmount + !LEAF;
+    if (mergedKeys < leftNode.keys.size()) {
+        // the children of the right node are moved and the right node is freed
+        if constexpr (!LEAF) {
+            unswizzleAll(rightNode);
+        }
+        unswizzleSlot(node.children[leftIndex + 1]);
+        if constexpr (LEAF) {
+            // append the right leaf (including its sibling pointer)
+            std::move(std::begin(rightNode.keys), std::begin(rightNode.keys) + rightNode.keyAmount,
+                      std::begin(leftNode.keys) + leftNode.keyAmount);
+            std::move(std::begin(rightNode.children), std::begin(rightNode.children) + rightNode.keyAmount + 1,
+                      std::begin(leftNode.children) + leftNode.keyAmount);
+        } else {
+            // pull the separator down and append the right node
+            leftNode.keys[leftNode.keyAmount] = node.keys[leftIndex];
+            std::move(std::begin(rightNode.keys), std::begin(rightNode.keys) + rightNode.keyAmount,
+                      std::begin(leftNode.keys) + leftNode.keyAmount + 1);
+            std::move(std::begin(rightNode.children), std::begin(rightNode.children) + rightNode.keyAmount + 1,
+                      std::begin(leftNode.children) + leftNode.keyAmount + 1);
+        }
+        leftNode.keyAmount = mergedKeys;
+        // remove the separator and the right node from the parent
+        std::move(std::begin(node.keys) + leftIndex + 1, std::begin(node.keys) + node.keyAmount,
+                  std::begin(node.keys) + leftIndex);
+        std::move(std::begin(node.children) + leftIndex + 2, std::begin(node.children) + node.keyAmount + 1,
+                  std::begin(node.children) + leftIndex + 1);
+        node.keyAmount--;
+        // clear the right node; late (optimistic) readers must not see its children
+        if constexpr (!LEAF) {
+            bufferManager.setInnerNode(rightPage.id, false);
+        }
+        initializeNode(rightPage);
+        freedPages.push_back(rightPage.id);
+        return true;
+    }
+    if (&leftPage == &childPage && rightNode.keyAmount > MIN_KEYS) {
+        // move the first entry of the right node to the left one
+        if constexpr (LEAF) {
+            leftNode.keys[leftNode.keyAmount] = rightNode.keys[0];
+            leftNode.children[leftNode.keyAmount + 1] = leftNode.children[leftNode.keyAmount];
+            leftNode.children[leftNode.keyAmount] = rightNode.children[0];
+            node.keys[leftIndex] = rightNode.keys[1];
+        } else {
+            unswizzleSlot(rightNode.children[0]);
+            leftNode.keys[leftNode.keyAmount] = node.keys[leftIndex];
+            leftNode.children[leftNode.keyAmount + 1] = rightNode.children[0];
+            node.keys[leftIndex] = rightNode.keys[0];
+        }
+        std::move(std::begin(rightNode.keys) + 1, std::begin(rightNode.keys) + rightNode.keyAmount,
+                  std::begin(rightNode.keys));
+        std::move(std::begin(rightNode.children) + 1, std::begin(rightNode.children) + rightNode.keyAmount + 1,
+                  std::begin(rightNode.children));
+        leftNode.keyAmount++;
+        rightNode.keyAmount--;
+        return true;
+    }
+    if (&rightPage == &childPage && leftNode.keyAmount > MIN_KEYS) {
+        // move the last entry of the left node to the right one
+        std::move_backward(std::begin(rightNode.keys), std::begin(rightNode.keys) + rightNode.keyAmount,
+                           std::begin(rightNode.keys) + rightNode.keyAmount + 1);
+        std::move_backward(std::begin(rightNode.children), std::begin(rightNode.children) + rightNode.keyAmount + 1,
+                           std::begin(rightNode.children) + rightNode.keyAmount + 2);
+        if constexpr (LEAF) {
+            rightNode.keys[0] = leftNode.keys[leftNode.keyAmount - 1];
+            rightNode.children[0] = leftNode.children[leftNode.keyAmount - 1];
+            leftNode.children[leftNode.keyAmount - 1] = leftNode.children[leftNode.keyAmount];
+            node.keys[leftIndex] = rightNode.keys[0];
+        } else {
+            unswizzleSlot(leftNode.children[leftNode.keyAmount]);
+            rightNode.keys[0] = node.keys[leftIndex];
+            rightNode.children[0] = leftNode.children[leftNode.keyAmount];
+            node.keys[leftIndex] = leftNode.keys[leftNode.keyAmount - 1];
+        }
+        leftNode.keyAmount--;
+        rightNode.keyAmount++;
+        return true;
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::erase(
+    uint64_t id, const KEY& key, bool eraseKey, std::vector<uint64_t>& freedPages, bool& underflow) {
+    buffer::Page<PAGE_SIZE>* page;
+    while (!(page = bufferManager.pinPage(id, true)))
+        ;
+    // get lock on node
+    std::unique_lock lock(page->mutex);
+    if (getHeader(*page).leaf) {
+        auto& leafNode = getLeaf(*page);
+        const bool found = eraseKey && eraseFromLeaf(leafNode, key);
+        underflow = leafNode.keyAmount < MIN_KEYS_PER_LEAF;
+        lock.unlock();
+        bufferManager.unpinPage(id, found);
+        return found;
+    }
+    auto& node = getInner(*page);
+    const size_t index = findChildrenIndex(node, key);
+    // find child and erase
+    bool childUnderflow = false;
+    const bool found = erase(toID(node.children[index]), key, eraseKey, freedPages, childUnderflow);
+    // the siblings are only touched if the child became underfull
+    bool modified = childUnderflow && tryMerge(node, index, freedPages);
+    // special case: the root has a single child; pull it up
+    if (id == root && node.keyAmount == 0) {
+        unswizzleAll(node);
+        const uint64_t childID = node.children[0];
+        buffer::Page<PAGE_SIZE>* childPage;
+        while (!(childPage = bufferManager.pinPage(childID, true)))
+            ;
+        childPage->mutex.lock();
+        if (getHeader(*childPage).leaf) {
+            initializeNode(*page);
+            getLeaf(*page) = getLeaf(*childPage);
+            bufferManager.setInnerNode(root, false);
+        } else {
+            unswizzleAll(getInner(*childPage));
+            node = getInner(*childPage);
+            bufferManager.setInnerNode(childID, false);
+        }
+        initializeNode(*childPage);
+        childPage->mutex.unlock();
+        bufferManager.unpinPage(childID, true);
+        freedPages.push_back(childID);
+        modified = true;
+    }
+    underflow = !getHeader(*page).leaf && node.keyAmount < MIN_KEYS_PER_INNER_NODE;
+    lock.unlock();
+    bufferManager.unpinPage(id, modified);
+    return found;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::optimisticDescend(
+    const KEY& key, bool shareParent, buffer::Page<PAGE_SIZE>*& parentPage, buffer::Page<PAGE_SIZE>*& leafPage) {
+    for (size_t attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++) {
+        // the visited nodes are not pinned; claiming a page for eviction or
+        // x-merge invalidates its version, so validation alone detects that
+        // a node was replaced, and swizzled children can't be evicted before
+        // their parent's version changes
+        buffer::Page<PAGE_SIZE>* parent = nullptr;
+        uint64_t parentVersion = 0;
+        buffer::Page<PAGE_SIZE>* current = bufferManager.findPage(root);
+        if (!current) {
+            // only pinned while it is loaded
+            while (!(current = bufferManager.pinPage(root, true)))
+                ;
+            bufferManager.unpinPage(*current, false);
+        }
+        uint64_t currentVersion = current->mutex.readVersion();
+        // the frame might have been reused meanwhile
+        bool valid = !current->claimed() && current->id == root;
+        while (valid) {
+            const bool leaf = getHeader(*current).leaf;
+            auto& node = getInner(*current);
+            const size_t index = leaf ? 0 : findChildrenIndex(node, key);
+            const uint64_t slot = leaf ? 0 : node.children[index];
+            // (a swizzled pointer must not be followed before it is validated)
+            if (!current->mutex.validate(currentVersion)) {
+                break;
+            }
+            if (leaf) {
+                // pin and lock top-down and check that nothing changed in
+                // between (a pin on a reused frame fails the validation)
+                const bool lockParent = parent && shareParent;
+                if (lockParent) {
+                    if (!bufferManager.pinPage(*parent)) {
+                        break;
+                    }
+                    parent->mutex.lock_shared();
+                    if (!parent->mutex.validate(parentVersion)) {
+                        parent->mutex.unlock_shared();
+                        bufferManager.unpinPage(*parent, false);
+                        break;
+                    }
+                }
+                const bool pinned = bufferManager.pinPage(*current);
+                if (pinned) {
+                    current->mutex.lock_shared();
+                }
+                if (!pinned || !current->mutex.validate(currentVersion)) {
+                    if (pinned) {
+                        current->mutex.unlock_shared();
+                        bufferManager.unpinPage(*current, false);
+                    }
+                    if (lockParent) {
+                        parent->mutex.unlock_shared();
+                        bufferManager.unpinPage(*parent, false);
+                    }
+                    break;
+                }
+                parentPage = lockParent ? parent : nullptr;
+                leafPage = current;
+                return true;
+            }
+            buffer::Page<PAGE_SIZE>* child;
+            uint64_t childVersion;
+            if (isSwizzled(slot)) {
+                child = toPage(slot);
+                childVersion = child->mutex.readVersion();
+                // the child is only valid if the current node did not change
+                // meanwhile (and it isn't being evicted)
+                if (child->claimed() || !current->mutex.validate(currentVersion)) {
+                    break;
+                }
+            } else {
+                // the child is pinned until it is swizzled, so that it stays
+                // in memory in between
+                while (!(child = bufferManager.pinPage(slot, true)))
+                    ;
+                childVersion = child->mutex.readVersion();
+                if (!current->mutex.validate(currentVersion)) {
+                    bufferManager.unpinPage(*child, false);
+                    break;
+                }
+                // swizzle the child if nobody else is using the current node;
+                // the current node is pinned as well, so that it isn't evicted
+                // while it references the child
+                if (bufferManager.pinPage(*current)) {
+                    if (current->mutex.tryUpgrade(currentVersion)) {
+                        swizzle(*current, node.children[index], *child);
+                        current->mutex.unlock();
+                        currentVersion += 2;
+                    }
+                    bufferManager.unpinPage(*current, false);
+                }
+                bufferManager.unpinPage(*child, false);
+            }
+            // set for next round
+            parent = current;
+            parentVersion = currentVersion;
+            current = child;
+            currentVersion = childVersion;
+        }
+        // conflict; restart
+#ifdef LOGGING
+        OPTIMISTIC_RESTARTS++;
+#endif
+        std::this_thread::yield();
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+buffer::Page<BTree<KEY, DATA, TOTAL_PAGE_SIZE>::PAGE_SIZE>*
+BTree<KEY, DATA, TOTAL_PAGE_SIZE>::findLeaf(const KEY& key) {
+    buffer::Page<PAGE_SIZE>* parentPage;
+    buffer::Page<PAGE_SIZE>* unused;
+    if (optimisticReadsEnabled && optimisticDescend(key, false, unused, parentPage)) {
+        return parentPage;
+    }
+    while (!(parentPage = bufferManager.pinPage(root, true)))
+        ;
+    parentPage->mutex.lock_shared();
+    while (true) {
+        if (getHeader(*parentPage).leaf) {
+            return parentPage;
+        }
+        auto& parentNode = getInner(*parentPage);
+        // pin page
+        buffer::Page<PAGE_SIZE>* currentPage = pinChild(parentNode.children[findChildrenIndex(parentNode, key)]);
+        currentPage->mutex.lock_shared();
+        parentPage->mutex.unlock_shared();
+        bufferManager.unpinPage(*parentPage, false);
+        // set for next round
+        parentPage = currentPage;
+    }
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::isInnerNode(
     buffer::Page<PAGE_SIZE>* page){
     assert(page);
-    return !getNode(*page).leaf;
+    return !getHeader(*page).leaf;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::hasResidentChildren(
+    buffer::Page<PAGE_SIZE>* page, const buffer::PageTable& loadedPages) {
+    assert(page);
+    if (getHeader(*page).leaf) {
+        return false;
+    }
+    const auto& node = getInner(*page);
+    for (size_t i = 0; i <= node.keyAmount; i++) {
+        // (swizzled children are resident anyway)
+        if (isSwizzled(node.children[i]) || loadedPages.contains(node.children[i])) {
+            return true;
+        }
+    }
+    return false;
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::tryXMerge(
     uint64_t pageID,
-    std::unordered_map<uint64_t, size_t>& loadedPages,
+    buffer::PageTable& loadedPages,
     std::unordered_set<uint64_t>& innerNodes,
-    std::array<std::unique_ptr<buffer::Page<PAGE_SIZE>>, PAGE_AMOUNT>& buffer,
+    buffer::PageArena<PAGE_SIZE>& buffer,
     disk::DiskManager<PAGE_SIZE>& bufferDiskManager) {
     // the function assumes that the required locks are held and that
-    // the requested page is not in memory
+    // the requested page is not in memory; all used pages are claimed so
+    // that they can't be pinned in the meantime
     if(innerNodes.empty()){
         return false;
     }
@@ -426,14 +1195,16 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
     auto randomPageIt = innerNodes.begin();
     std::advance(randomPageIt, distribution(engine));
     assert(loadedPages.contains(*randomPageIt));
-    const size_t randomIndex = loadedPages.at(*randomPageIt);
+    const size_t randomIndex = *loadedPages.find(*randomPageIt);
     // look for a random page which could work
-    auto& ptr = buffer[randomIndex];
-    if (!ptr || ptr->deleted || ptr->pinned > 0) {
+    auto* ptr = buffer[randomIndex];
+    if (!ptr || ptr->deleted || !ptr->tryClaim()) {
         return false;
     }
-    auto& node = getNode(*ptr);
-    if (node.leaf || node.keyAmount <= 1) {
+    auto& node = getInner(*ptr);
+    // (swizzled children would have to be unswizzled first)
+    if (node.leaf || node.keyAmount <= 1 || ptr->swizzledChildren > 0) {
+        ptr->release();
         return false;
     }
     // found one; search for a range of children which are loaded
@@ -447,6 +1218,9 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
     const auto clear = [&](size_t currentIndex) {
         currentSlots = 0;
         startingIndex = currentIndex + 1;
+        for (auto* page : currentlyUsed) {
+            page->release();
+        }
         currentlyUsed.clear();
     };
     for (size_t i = randomStartingIndex; i < node.keyAmount + 1 &&
@@ -454,48 +1228,57 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
          i++) {
         // check if the child is usable
         const uint64_t childID = node.children[i];
-        if (!loadedPages.contains(childID)) {
+        const std::optional<size_t> childIndex = loadedPages.find(childID);
+        if (!childIndex) {
             // child is not loaded
             clear(i);
             continue;
         }
-        auto& childPtr = buffer[loadedPages.at(childID)];
+        auto* childPtr = buffer[*childIndex];
         assert(childPtr);
         if (childPtr->deleted) {
             // child was deleted
             clear(i);
             continue;
         }
-        if (childPtr->pinned > 0) {
+        if (!childPtr->tryClaim()) {
             // child is currently being used
             clear(i);
             continue;
         }
-        auto& childNode = getNode(*childPtr);
+        if (childPtr->swizzledChildren > 0) {
+            // its children would be moved
+            childPtr->release();
+            clear(i);
+            continue;
+        }
+        // (all children of a node are of the same kind)
+        const bool childLeaf = getHeader(*childPtr).leaf;
+        const size_t capacity = childLeaf ? getLeaf(*childPtr).keys.size() : getInner(*childPtr).keys.size();
         // get the free slots of the child
-        const size_t freeSlots = childNode.keys.size() - childNode.keyAmount - 1;
+        const size_t freeSlots = capacity - getHeader(*childPtr).keyAmount - 1;
         currentSlots += freeSlots;
-        currentlyUsed.push_back(childPtr.get());
-        // check if the current combination would be enough
-        if (childNode.leaf && currentSlots < node.keys.size()) {
+        currentlyUsed.push_back(childPtr);
+        // check if the current combination would be enough to empty a child
+        if (childLeaf && currentSlots < capacity) {
             continue;
         }
-        if (!childNode.leaf && currentSlots < node.keys.size() + 1) {
+        if (!childLeaf && currentSlots < capacity + 1) {
             continue;
         }
         // perform the merge
         size_t rightChildIndex = currentlyUsed.size() - 1;
         size_t leftChildIndex = rightChildIndex - 1;
-        if (childNode.leaf) {
+        if (childLeaf) {
             // go from right to left
             while (leftChildIndex != static_cast<size_t>(-1)) {
                 size_t currentKeyIndex = startingIndex + rightChildIndex - 1;
                 auto* leftPage = currentlyUsed[leftChildIndex];
                 auto* rightPage = currentlyUsed[rightChildIndex];
-                assert(leftPage->pinned == 0);
-                assert(rightPage->pinned == 0);
-                auto& leftNode = getNode(*leftPage);
-                auto& rightNode = getNode(*rightPage);
+                assert(leftPage->pinned & buffer::Page<PAGE_SIZE>::CLAIMED);
+                assert(rightPage->pinned & buffer::Page<PAGE_SIZE>::CLAIMED);
+                auto& leftNode = getLeaf(*leftPage);
+                auto& rightNode = getLeaf(*rightPage);
                 assert(leftNode.leaf);
                 assert(rightNode.leaf);
                 leftPage->modified = true;
@@ -503,13 +1286,13 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
                 const size_t slotsToBeMoved = std::min(
                     leftNode.keyAmount,
                     static_cast<uint32_t>(rightNode.keys.size()) - rightNode.keyAmount - 1);
-                // make room in the right node
-                std::move(rightNode.keys.begin(),
-                          rightNode.keys.begin() + rightNode.keyAmount,
-                          rightNode.keys.begin() + slotsToBeMoved);
-                std::move(rightNode.children.begin(),
-                          rightNode.children.begin() + rightNode.keyAmount,
-                          rightNode.children.begin() + slotsToBeMoved);
+                // make room in the right node (keeping its sibling pointer)
+                std::move_backward(rightNode.keys.begin(),
+                                   rightNode.keys.begin() + rightNode.keyAmount,
+                                   rightNode.keys.begin() + rightNode.keyAmount + slotsToBeMoved);
+                std::move_backward(rightNode.children.begin(),
+                                   rightNode.children.begin() + rightNode.keyAmount + 1,
+                                   rightNode.children.begin() + rightNode.keyAmount + 1 + slotsToBeMoved);
                 // move from left to right
                 std::move(leftNode.keys.begin() + leftNode.keyAmount - slotsToBeMoved,
                           leftNode.keys.begin() + leftNode.keyAmount,
@@ -517,10 +1300,11 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
                 std::move(leftNode.children.begin() + leftNode.keyAmount - slotsToBeMoved,
                           leftNode.children.begin() + leftNode.keyAmount,
                           rightNode.children.begin());
-                // set key amount
-                leftNode.children[leftNode.keyAmount] = rightPage->id;
+                // set key amount and keep the sibling pointer of the left node
+                const uint64_t leftSibling = leftNode.children[leftNode.keyAmount];
                 leftNode.keyAmount -= slotsToBeMoved;
                 rightNode.keyAmount += slotsToBeMoved;
+                leftNode.children[leftNode.keyAmount] = leftSibling;
                 // move right pointer
                 bool movedLeft = false;
                 if (rightNode.keyAmount == rightNode.keys.size() - 1) {
@@ -543,10 +1327,10 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
                 const size_t currentKeyIndex = startingIndex + rightChildIndex - 1;
                 auto* leftPage = currentlyUsed[leftChildIndex];
                 auto* rightPage = currentlyUsed[rightChildIndex];
-                assert(leftPage->pinned == 0);
-                assert(rightPage->pinned == 0);
-                auto& leftNode = getNode(*leftPage);
-                auto& rightNode = getNode(*rightPage);
+                assert(leftPage->pinned & buffer::Page<PAGE_SIZE>::CLAIMED);
+                assert(rightPage->pinned & buffer::Page<PAGE_SIZE>::CLAIMED);
+                auto& leftNode = getInner(*leftPage);
+                auto& rightNode = getInner(*rightPage);
                 assert(!leftNode.leaf);
                 assert(!rightNode.leaf);
                 leftPage->modified = true;
@@ -576,7 +1360,7 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
                 }
                 if (mustTransferChild) {
                     rightNode.children[slotsToBeMoved - 1] =
-                        getNode(*currentlyUsed[rightChildIndex - 1]).children[0];
+                        getInner(*currentlyUsed[rightChildIndex - 1]).children[0];
                 }
                 // move from left to right
                 std::move(leftNode.keys.begin() + leftNode.keyAmount - directlyMoved,
@@ -587,7 +1371,7 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
                           rightNode.children.begin());
                 if (mustTransferChild) {
                     // move the last child into the empty node
-                    getNode(*currentlyUsed[rightChildIndex - 1]).children[0] =
+                    getInner(*currentlyUsed[rightChildIndex - 1]).children[0] =
                         leftNode.children[leftNode.keyAmount + 1 - slotsToBeMoved];
                 }
                 // move the leftmost child(s) of the left node into the parent
@@ -641,165 +1425,254 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::tryXMerge(
         // mark the node as modified
         ptr->modified = true;
         assert(node.keyAmount >= 1);
+        if (childLeaf) {
+            assert(getLeaf(*currentlyUsed[0]).keyAmount == 0);
+            // the left neighbour of the first leaf still points to it; keep the
+            // first page and free the second one instead (after moving its content)
+            getLeaf(*currentlyUsed[0]) = getLeaf(*currentlyUsed[1]);
+            node.children[startingIndex] = currentlyUsed[0]->id;
+            std::swap(currentlyUsed[0], currentlyUsed[1]);
+        }
         const size_t firstID = currentlyUsed[0]->id;
         // the first node was freed; now we can use its place in the buffer
         // delete the first node
-        const size_t firstPageHand = loadedPages.at(firstID);
-        bufferDiskManager.deletePage(firstID);
+        const size_t firstPageHand = *loadedPages.find(firstID);
         loadedPages.erase(firstID);
+        bufferDiskManager.deletePage(firstID);
         innerNodes.erase(firstID);
+        for (size_t i = 1; i < currentlyUsed.size(); i++) {
+            currentlyUsed[i]->release();
+        }
+        ptr->release();
         // load the new page
-        auto newPage = std::make_unique<buffer::Page<PAGE_SIZE>>(
-            pageID, std::move(bufferDiskManager.retrievePage(pageID)));
-        buffer[firstPageHand] = std::move(newPage);
-        loadedPages[pageID] = firstPageHand;
+        assert(buffer[firstPageHand] == currentlyUsed[0]);
+        bufferDiskManager.readPage(pageID, currentlyUsed[0]->frame);
+        currentlyUsed[0]->reset(pageID);
+        loadedPages.insert(pageID, firstPageHand);
         return true;
     }
     // unsuccessful
+    clear(node.keyAmount);
+    ptr->release();
     return false;
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-size_t BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::size() const {
-    return diskManager.entryAmount();
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+size_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::size() const {
+    return tupleAmount;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::setMemoryBudget(size_t bytes) {
+    const size_t heapBytes = bytes * HEAP_PERCENTAGE / 100;
+    bufferManager.setMemoryBudget(bytes - heapBytes);
+    if constexpr (!INLINE_DATA) {
+        heapFile->setMemoryBudget(heapBytes);
+    }
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-std::optional<DATA> BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::find(const KEY& key) {
-    uint64_t parentID = root;
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+std::optional<DATA> BTree<KEY, DATA, TOTAL_PAGE_SIZE>::find(const KEY& key) {
     buffer::Page<PAGE_SIZE>* parentPage;
-    while (!(parentPage = bufferManager.pinPage(parentID, true)))
-        ;
-    parentPage->mutex.lock_shared();
+    buffer::Page<PAGE_SIZE>* unused;
+    if (!optimisticReadsEnabled || !optimisticDescend(key, false, unused, parentPage)) {
+        while (!(parentPage = bufferManager.pinPage(root, true)))
+            ;
+        parentPage->mutex.lock_shared();
+    }
     while (true) {
         assert(parentPage->pinned > 0);
-        auto& parentNode = getNode(*parentPage);
-        if (parentNode.leaf) {
-            for (size_t i = 0; i < parentNode.keyAmount; i++) {
-                if (parentNode.keys[i] == key) {
-                    uint64_t id = parentNode.children[i];
-                    auto frame = std::move(diskManager.retrievePage(id));
-                    DATA data = std::move(getData(frame));
-                    parentPage->mutex.unlock_shared();
-                    bufferManager.unpinPage(parentID, false);
-                    return data;
-                }
+        if (getHeader(*parentPage).leaf) {
+            auto& leafNode = getLeaf(*parentPage);
+            if (const std::optional<size_t> i = findKeyIndex(leafNode, key)) {
+                DATA data = readTuple(leafNode.children[*i]);
+                parentPage->mutex.unlock_shared();
+                bufferManager.unpinPage(*parentPage, false);
+                return data;
             }
             parentPage->mutex.unlock_shared();
-            bufferManager.unpinPage(parentID, false);
+            bufferManager.unpinPage(*parentPage, false);
             return std::nullopt;
         }
-        uint64_t currentID = parentNode.children[findChildrenIndex(parentNode, key)];
+        auto& parentNode = getInner(*parentPage);
         // pin page
-        buffer::Page<PAGE_SIZE>* currentPage;
-        while (!(currentPage = bufferManager.pinPage(currentID, true)))
-            ;
+        buffer::Page<PAGE_SIZE>* currentPage = pinChild(parentNode.children[findChildrenIndex(parentNode, key)]);
         currentPage->mutex.lock_shared();
         parentPage->mutex.unlock_shared();
-        bufferManager.unpinPage(parentID, false);
+        bufferManager.unpinPage(*parentPage, false);
         // set for next round
-        parentID = currentID;
         parentPage = currentPage;
     }
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::insert(KEY key, DATA data) {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::insert(KEY key, DATA data) {
     insert(root, std::move(key), std::move(data));
+    tupleAmount++;
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::contains(const KEY& key) {
-    uint64_t parentID = root;
-    buffer::Page<PAGE_SIZE>* parentPage;
-    while (!(parentPage = bufferManager.pinPage(parentID, true)))
-        ;
-    parentPage->mutex.lock_shared();
-    while (true) {
-        assert(parentPage->pinned > 0);
-        auto& parentNode = getNode(*parentPage);
-        for (size_t i = 0; i < parentNode.keyAmount; i++) {
-            if (parentNode.keys[i] == key) {
-                parentPage->mutex.unlock_shared();
-                bufferManager.unpinPage(parentID, false);
-                return true;
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+size_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::fillAmount(double fillFactor, size_t keysPerNode) {
+    const auto amount = static_cast<size_t>(keysPerNode * fillFactor);
+    return std::clamp<size_t>(amount, 1, keysPerNode);
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+std::vector<std::pair<KEY, uint64_t>> BTree<KEY, DATA, TOTAL_PAGE_SIZE>::buildInnerLevel(
+    const std::vector<std::pair<KEY, uint64_t>>& children, double fillFactor) {
+    // spread the children evenly, so that the last node isn't underfull
+    const size_t fanout = fillAmount(fillFactor, KEYS_PER_INNER_NODE) + 1;
+    const size_t nodeAmount = (children.size() + fanout - 1) / fanout;
+    std::vector<std::pair<KEY, uint64_t>> level;
+    level.reserve(nodeAmount);
+    size_t first = 0;
+    for (size_t i = 0; i < nodeAmount; i++) {
+        const size_t amount = children.size() / nodeAmount + (i < children.size() % nodeAmount);
+        const uint64_t id = nodeAmount == 1 ? root : bufferManager.newPage();
+        buffer::Page<PAGE_SIZE>* page;
+        while (!(page = bufferManager.pinPage(id)))
+            ;
+        initializeNode(*page, false);
+        auto& node = getInner(*page);
+        bufferManager.setInnerNode(id, true);
+        node.keyAmount = amount - 1;
+        // the separators are the first keys of the right children
+        for (size_t j = 0; j < amount; j++) {
+            if (j > 0) {
+                node.keys[j - 1] = children[first + j].first;
             }
+            node.children[j] = children[first + j].second;
         }
-        if (parentNode.leaf) {
-            parentPage->mutex.unlock_shared();
-            bufferManager.unpinPage(parentID, false);
-            return false;
+        bufferManager.unpinPage(id, true);
+        level.emplace_back(children[first].first, id);
+        first += amount;
+    }
+    return level;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+template <std::ranges::forward_range RANGE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::bulkLoad(const RANGE& tuples, double fillFactor) {
+    if (size() != 0) {
+        throw std::runtime_error("bulk load into a non-empty tree");
+    }
+    // check the input before anything is written
+    size_t tupleCount = 0;
+    const KEY* previous = nullptr;
+    for (const auto& [key, data] : tuples) {
+        if (previous && key < *previous) {
+            throw std::runtime_error("bulk load of unsorted keys");
         }
-        uint64_t currentID = parentNode.children[findChildrenIndex(parentNode, key)];
-        // pin page
-        buffer::Page<PAGE_SIZE>* currentPage;
-        while (!(currentPage = bufferManager.pinPage(currentID, true)))
+        previous = &key;
+        tupleCount++;
+    }
+    if (tupleCount == 0) {
+        return;
+    }
+    // the leaves are allocated in key order, so that they are stored sequentially
+    const size_t perLeaf = fillAmount(fillFactor, KEYS_PER_LEAF);
+    const size_t leafAmount = (tupleCount + perLeaf - 1) / perLeaf;
+    std::vector<std::pair<KEY, uint64_t>> leaves(leafAmount);
+    for (size_t i = 0; i < leafAmount; i++) {
+        leaves[i].second = leafAmount == 1 ? root : bufferManager.newPage();
+    }
+    auto it = std::ranges::begin(tuples);
+    for (size_t i = 0; i < leafAmount; i++) {
+        const size_t amount = tupleCount / leafAmount + (i < tupleCount % leafAmount);
+        const uint64_t id = leaves[i].second;
+        buffer::Page<PAGE_SIZE>* page;
+        while (!(page = bufferManager.pinPage(id)))
             ;
-        currentPage->mutex.lock_shared();
-        parentPage->mutex.unlock_shared();
-        bufferManager.unpinPage(parentID, false);
-        // set for next round
-        parentID = currentID;
-        parentPage = currentPage;
+        initializeNode(*page);
+        auto& node = getLeaf(*page);
+        for (size_t j = 0; j < amount; j++, ++it) {
+            const auto& [key, data] = *it;
+            node.keys[j] = key;
+            node.children[j] = createTuple(data);
+        }
+        node.keyAmount = amount;
+        // the last leaf terminates the chain
+        node.children[amount] = i + 1 < leafAmount ? leaves[i + 1].second : root;
+        leaves[i].first = node.keys[0];
+        bufferManager.unpinPage(id, true);
     }
+    // build the inner levels up to the root
+    std::vector<std::pair<KEY, uint64_t>> level = std::move(leaves);
+    while (level.size() > 1) {
+        level = buildInnerLevel(level, fillFactor);
+    }
+    tupleAmount = tupleCount;
 }
 // --------------------------------------------------------------------------
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::update(
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::contains(const KEY& key) {
+    // only leaves are checked since inner keys may belong to erased tuples
+    buffer::Page<PAGE_SIZE>* leafPage = findLeaf(key);
+    auto& leafNode = getLeaf(*leafPage);
+    const bool found = findKeyIndex(leafNode, key).has_value();
+    leafPage->mutex.unlock_shared();
+    bufferManager.unpinPage(*leafPage, false);
+    return found;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::update(
     const KEY& key, const std::function<void(DATA&)>& func) {
     buffer::Page<PAGE_SIZE>* parentPage = nullptr;
     buffer::Page<PAGE_SIZE>* currentPage;
-    while (!(currentPage = bufferManager.pinPage(root, true)))
-        ;
-    currentPage->mutex.lock_shared();
+    if (!optimisticReadsEnabled || !optimisticDescend(key, true, parentPage, currentPage)) {
+        while (!(currentPage = bufferManager.pinPage(root, true)))
+            ;
+        currentPage->mutex.lock_shared();
+    }
     while (true) {
-        auto& currentNode = getNode(*currentPage);
         assert(currentPage->pinned > 0);
-        if (currentNode.leaf) {
+        if (getHeader(*currentPage).leaf) {
             // -> we need to lock it exclusively
             currentPage->mutex.unlock_shared();
             bool fastPath = currentPage->mutex.try_lock();
             if (!fastPath) {
                 currentPage->mutex.lock();
             }
-            if(currentNode.leaf){
+            if (getHeader(*currentPage).leaf) {
+                auto& currentNode = getLeaf(*currentPage);
                 // now current is exclusively held (the parent is shared)
-                for (size_t i = 0; i < currentNode.keyAmount; i++) {
-                    if (currentNode.keys[i] == key) {
-                        uint64_t id = currentNode.children[i];
-                        auto frame = std::move(diskManager.retrievePage(id));
-                        func(getData(frame));
-                        diskManager.writePage(id, frame);
-                        // CONTENTION SPLIT
-                        bool contentionSplitAttempt = false;
-                        bool contentionSplit = false;
-                        if (currentPage->id != root && parentPage->id != root) {
-                            assert(parentPage != nullptr);
-                            assert(currentPage->pinned > 0);
-                            assert(parentPage->pinned > 0);
-                            auto result = tryContentionSplit(*parentPage, *currentPage, fastPath, i, key);
-                            contentionSplitAttempt = result.first;
-                            contentionSplit = result.second;
-                        }
-                        if (contentionSplitAttempt) {
-                            parentPage->mutex.unlock();
-                        } else if (parentPage) {
-                            parentPage->mutex.unlock_shared();
-                        }
-                        currentPage->mutex.unlock();
-                        if (parentPage) {
-                            assert(parentPage->pinned >= 1);
-                            bufferManager.unpinPage(parentPage->id, contentionSplit);
-                        }
-                        assert(currentPage->pinned >= 1);
-                        bufferManager.unpinPage(currentPage->id, contentionSplit);
-                        return true;
+                if (const std::optional<size_t> index = findKeyIndex(currentNode, key)) {
+                    const size_t i = *index;
+                    const bool modified = updateTuple(currentNode.children[i], func);
+                    // CONTENTION SPLIT
+                    bool contentionSplitAttempt = false;
+                    bool contentionSplit = false;
+                    if (currentPage->id != root && parentPage->id != root) {
+                        assert(parentPage != nullptr);
+                        assert(currentPage->pinned > 0);
+                        assert(parentPage->pinned > 0);
+                        auto result = tryContentionSplit(*parentPage, *currentPage, fastPath, i, key);
+                        contentionSplitAttempt = result.first;
+                        contentionSplit = result.second;
+                    }
+                    if (contentionSplitAttempt) {
+                        parentPage->mutex.unlock();
+                    } else if (parentPage) {
+                        parentPage->mutex.unlock_shared();
+                    }
+                    currentPage->mutex.unlock();
+                    if (parentPage) {
+                        assert(parentPage->pinned >= 1);
+                        bufferManager.unpinPage(*parentPage, contentionSplit);
                     }
+                    assert(currentPage->pinned >= 1);
+                    bufferManager.unpinPage(*currentPage, contentionSplit || modified);
+                    return true;
                 }
                 if (parentPage) {
                     parentPage->mutex.unlock_shared();
@@ -807,25 +1680,23 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::update(
                 currentPage->mutex.unlock();
                 if (parentPage) {
                     assert(parentPage->pinned >= 1);
-                    bufferManager.unpinPage(parentPage->id, false);
+                    bufferManager.unpinPage(*parentPage, false);
                 }
                 assert(currentPage->pinned >= 1);
-                bufferManager.unpinPage(currentPage->id, false);
+                bufferManager.unpinPage(*currentPage, false);
                 return false;
             }
             currentPage->mutex.unlock();
             currentPage->mutex.lock_shared();
         }
-        const uint64_t nextID = currentNode.children[findChildrenIndex(currentNode, key)];
+        auto& currentNode = getInner(*currentPage);
         // pin page
-        buffer::Page<PAGE_SIZE>* nextPage;
-        while (!(nextPage = bufferManager.pinPage(nextID, true)))
-            ;
+        buffer::Page<PAGE_SIZE>* nextPage = pinChild(currentNode.children[findChildrenIndex(currentNode, key)]);
         nextPage->mutex.lock_shared();
         if (parentPage) {
             parentPage->mutex.unlock_shared();
             assert(parentPage->pinned >= 1);
-            bufferManager.unpinPage(parentPage->id, false);
+            bufferManager.unpinPage(*parentPage, false);
         }
         // set for next round
         parentPage = currentPage;
@@ -833,14 +1704,119 @@ bool BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::update(
     }
 }
 // --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+bool BTree<KEY, DATA, TOTAL_PAGE_SIZE>::erase(const KEY& key) {
+    std::vector<uint64_t> freedPages;
+    bool found = false;
+    bool done = false;
+    buffer::Page<PAGE_SIZE>* parentPage = nullptr;
+    buffer::Page<PAGE_SIZE>* leafPage;
+    if (optimisticReadsEnabled && optimisticDescend(key, true, parentPage, leafPage)) {
+        // fast path: the shared parent prevents splits and merges of the leaf
+        // (its version tells whether it changed until the leaf is merged)
+        const uint64_t parentVersion = parentPage ? parentPage->mutex.readVersion() : 0;
+        leafPage->mutex.unlock_shared();
+        leafPage->mutex.lock();
+        bool underflow = false;
+        // (the root might have been split in the meantime)
+        if (getHeader(*leafPage).leaf) {
+            auto& leafNode = getLeaf(*leafPage);
+            found = eraseFromLeaf(leafNode, key);
+            underflow = leafNode.keyAmount < MIN_KEYS_PER_LEAF;
+            done = true;
+        }
+        leafPage->mutex.unlock();
+        bufferManager.unpinPage(*leafPage, found);
+        bool parentUnderflow = false;
+        if (parentPage) {
+            parentPage->mutex.unlock_shared();
+            // merge the leaf from its parent unless somebody else changed the
+            // parent meanwhile (then the leaf is merged lazily by a later erase)
+            bool merged = false;
+            if (done && found && underflow && parentPage->mutex.tryUpgrade(parentVersion)) {
+                auto& parentNode = getInner(*parentPage);
+                merged = tryMerge(parentNode, findChildrenIndex(parentNode, key), freedPages);
+                parentUnderflow = parentPage->id == root ? parentNode.keyAmount == 0
+                                                         : parentNode.keyAmount < MIN_KEYS_PER_INNER_NODE;
+                parentPage->mutex.unlock();
+            }
+            bufferManager.unpinPage(*parentPage, merged);
+        }
+        if (parentUnderflow) {
+            // only then the ancestors are latched exclusively
+            bool rootUnderflow = false;
+            erase(root, key, false, freedPages, rootUnderflow);
+        }
+    }
+    if (!done) {
+        bool rootUnderflow = false;
+        found = erase(root, key, true, freedPages, rootUnderflow);
+    }
+    // the freed pages are unreachable now; their frames are reclaimed once late
+    // readers unpinned them
+    for (uint64_t id : freedPages) {
+        bufferManager.deletePage(id);
+    }
+    if (found) {
+        tupleAmount--;
+    }
+    return found;
+}
+// --------------------------------------------------------------------------
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+size_t BTree<KEY, DATA, TOTAL_PAGE_SIZE>::scan(
+    const KEY& key, size_t amount, const std::function<void(const KEY&, const DATA&)>& func) {
+    if (amount == 0) {
+        return 0;
+    }
+    // seek once
+    buffer::Page<PAGE_SIZE>* currentPage = findLeaf(key);
+    auto& firstNode = getLeaf(*currentPage);
+    size_t index = lowerBound(firstNode.keys.data(), firstNode.keyAmount, key);
+    size_t scanned = 0;
+    while (true) {
+        auto& currentNode = getLeaf(*currentPage);
+        if constexpr (!INLINE_DATA) {
+            // the records of the leaf are read in one batch
+            const size_t end = std::min<size_t>(currentNode.keyAmount, index + amount - scanned);
+            if (end > index + 1) {
+                heapFile->prefetch(std::vector<uint64_t>(currentNode.children.begin() + index,
+                                                         currentNode.children.begin() + end));
+            }
+        }
+        for (; index < currentNode.keyAmount && scanned < amount; index++) {
+            func(currentNode.keys[index], readTuple(currentNode.children[index]));
+            scanned++;
+        }
+        const uint64_t nextID = currentNode.children[currentNode.keyAmount];
+        if (scanned == amount || nextID == root) {
+            currentPage->mutex.unlock_shared();
+            bufferManager.unpinPage(*currentPage, false);
+            return scanned;
+        }
+        // follow the leaf chain (hand-over-hand)
+        buffer::Page<PAGE_SIZE>* nextPage;
+        while (!(nextPage = bufferManager.pinPage(nextID, true)))
+            ;
+        nextPage->mutex.lock_shared();
+        currentPage->mutex.unlock_shared();
+        bufferManager.unpinPage(*currentPage, false);
+        // set for next round
+        currentPage = nextPage;
+        index = 0;
+    }
+}
+// --------------------------------------------------------------------------
 /*
-template <class KEY, class DATA, size_t PAGE_AMOUNT, size_t TOTAL_PAGE_SIZE>
-requires ValidPageSize<KEY, TOTAL_PAGE_SIZE>
-void BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE>::print(uint64_t id, bool first) {
+template <class KEY, class DATA, size_t TOTAL_PAGE_SIZE>
+requires ValidPageSize<KEY, DATA, TOTAL_PAGE_SIZE>
+void BTree<KEY, DATA, TOTAL_PAGE_SIZE>::print(uint64_t id, bool first) {
     buffer::Page<PAGE_SIZE>* page;
     while (!(page = bufferManager.pinPage(id, true)))
         ;
-    auto& node = getNode(*page);
+    auto& node = getInner(*page);
     bool leaf = node.leaf;
     if (first) {
         std::cout << "digraph{\n";
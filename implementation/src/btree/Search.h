@@ -0,0 +1,151 @@
+#ifndef BTREE_SEARCH_H
+#define BTREE_SEARCH_H
+// --------------------------------------------------------------------------
+#include <bit>
+#include <cinttypes>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+// --------------------------------------------------------------------------
+namespace btree {
+// --------------------------------------------------------------------------
+// width of the vector registers used for searching (0 = scalar only)
+#if defined(__AVX2__)
+static constexpr size_t SIMD_WIDTH = 32;
+#elif defined(__SSE4_2__)
+static constexpr size_t SIMD_WIDTH = 16;
+#else
+static constexpr size_t SIMD_WIDTH = 0;
+#endif
+// --------------------------------------------------------------------------
+template <class KEY>
+// integral 32 and 64 bit keys can be compared with vector instructions
+concept SimdSearchable =
+    SIMD_WIDTH > 0 && std::is_integral_v<KEY> && (sizeof(KEY) == 4 || sizeof(KEY) == 8);
+// --------------------------------------------------------------------------
+// the binary search stops at windows of this size which are scanned linearly
+static constexpr size_t SEARCH_WINDOW = 16;
+// --------------------------------------------------------------------------
+template <bool INCLUSIVE, class KEY>
+// counts the keys which are less than (or equal to, if inclusive) the given
+// one; branch-free, so that the result can be computed with conditional moves
+size_t countLinear(const KEY* keys, size_t amount, const KEY& key) {
+    size_t count = 0;
+    for (size_t i = 0; i < amount; i++) {
+        if constexpr (INCLUSIVE) {
+            count += !(key < keys[i]);
+        } else {
+            count += keys[i] < key;
+        }
+    }
+    return count;
+}
+// --------------------------------------------------------------------------
+#if defined(__AVX2__) || defined(__SSE4_2__)
+template <bool INCLUSIVE, class KEY>
+requires SimdSearchable<KEY>
+size_t countSimd(const KEY* keys, size_t amount, const KEY& key) {
+    using SIGNED = std::make_signed_t<KEY>;
+    constexpr size_t LANES = SIMD_WIDTH / sizeof(KEY);
+    // the instructions only compare signed integers; flip the sign bit of unsigned ones
+    constexpr SIGNED BIAS = std::is_signed_v<KEY> ? 0 : std::numeric_limits<SIGNED>::min();
+    const SIGNED needle = static_cast<SIGNED>(key) ^ BIAS;
+#if defined(__AVX2__)
+    using Vector = __m256i;
+    const auto broadcast = [](SIGNED value) {
+        if constexpr (sizeof(KEY) == 4) {
+            return _mm256_set1_epi32(value);
+        } else {
+            return _mm256_set1_epi64x(value);
+        }
+    };
+    const auto greater = [](Vector a, Vector b) {
+        if constexpr (sizeof(KEY) == 4) {
+            return _mm256_cmpgt_epi32(a, b);
+        } else {
+            return _mm256_cmpgt_epi64(a, b);
+        }
+    };
+    const auto load = [](const KEY* ptr) { return _mm256_loadu_si256(reinterpret_cast<const Vector*>(ptr)); };
+    const auto bits = [](Vector v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); };
+    const auto combine = [](Vector a, Vector b) { return _mm256_xor_si256(a, b); };
+#else
+    using Vector = __m128i;
+    const auto broadcast = [](SIGNED value) {
+        if constexpr (sizeof(KEY) == 4) {
+            return _mm_set1_epi32(value);
+        } else {
+            return _mm_set1_epi64x(value);
+        }
+    };
+    const auto greater = [](Vector a, Vector b) {
+        if constexpr (sizeof(KEY) == 4) {
+            return _mm_cmpgt_epi32(a, b);
+        } else {
+            return _mm_cmpgt_epi64(a, b);
+        }
+    };
+    const auto load = [](const KEY* ptr) { return _mm_loadu_si128(reinterpret_cast<const Vector*>(ptr)); };
+    const auto bits = [](Vector v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); };
+    const auto combine = [](Vector a, Vector b) { return _mm_xor_si128(a, b); };
+#endif
+    const Vector bias = broadcast(BIAS);
+    const Vector needles = broadcast(needle);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + LANES <= amount; i += LANES) {
+        const Vector values = combine(load(keys + i), bias);
+        // every matching lane sets sizeof(KEY) bits of the mask
+        if constexpr (INCLUSIVE) {
+            count += LANES - std::popcount(bits(greater(values, needles))) / sizeof(KEY);
+        } else {
+            count += std::popcount(bits(greater(needles, values))) / sizeof(KEY);
+        }
+    }
+    return count + countLinear<INCLUSIVE>(keys + i, amount - i, key);
+}
+#endif
+// --------------------------------------------------------------------------
+template <bool INCLUSIVE, class KEY>
+// returns the amount of sorted keys which are less than (or equal to, if
+// inclusive) the given one
+size_t rank(const KEY* keys, size_t amount, const KEY& key) {
+    const KEY* first = keys;
+    size_t length = amount;
+    // branch-free binary search; the result always stays in [first, first + length]
+    while (length > SEARCH_WINDOW) {
+        const size_t half = length / 2;
+        if constexpr (INCLUSIVE) {
+            first = key < first[half] ? first : first + half;
+        } else {
+            first = first[half] < key ? first + half : first;
+        }
+        length -= half;
+    }
+    const size_t offset = first - keys;
+#if defined(__AVX2__) || defined(__SSE4_2__)
+    if constexpr (SimdSearchable<KEY>) {
+        return offset + countSimd<INCLUSIVE>(first, length, key);
+    }
+#endif
+    return offset + countLinear<INCLUSIVE>(first, length, key);
+}
+// --------------------------------------------------------------------------
+template <class KEY>
+// index of the first key which is not less than the given one
+size_t lowerBound(const KEY* keys, size_t amount, const KEY& key) {
+    return rank<false>(keys, amount, key);
+}
+// --------------------------------------------------------------------------
+template <class KEY>
+// index of the first key which is greater than the given one
+size_t upperBound(const KEY* keys, size_t amount, const KEY& key) {
+    return rank<true>(keys, amount, key);
+}
+// --------------------------------------------------------------------------
+} // namespace btree
+// --------------------------------------------------------------------------
+#endif //BTREE_SEARCH_H
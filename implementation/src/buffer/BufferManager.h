@@ -2,13 +2,18 @@
 #define BTREE_BUFFERMANAGER_H
 // --------------------------------------------------------------------------
 #include "DiskManager.h"
+#include "Replacement.h"
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <bitset>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <string>
@@ -16,12 +21,80 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 #include <iostream>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
 // --------------------------------------------------------------------------
 namespace buffer {
 // --------------------------------------------------------------------------
+// shared mutex with a version counter that allows optimistic reads; the
+// version is odd while the latch is held exclusively and every exclusive
+// critical section increments it by two; waiting writers are preferred so
+// that a stream of readers can't starve them (shared locks must not be
+// acquired recursively)
+class OptimisticLatch {
+    private:
+    pthread_rwlock_t mutex;
+    std::atomic<uint64_t> version;
+
+    public:
+    OptimisticLatch();
+    ~OptimisticLatch();
+    OptimisticLatch(const OptimisticLatch&) = delete;
+    OptimisticLatch& operator=(const OptimisticLatch&) = delete;
+    void lock();
+    bool try_lock();
+    void unlock();
+    void lock_shared();
+    bool try_lock_shared();
+    void unlock_shared();
+    // locks exclusively if no writer has been active since the version was
+    // read (the version is incremented by the lock)
+    bool tryUpgrade(uint64_t);
+    // returns the current version; waits if the latch is held exclusively
+    uint64_t readVersion();
+    // checks whether no writer has been active since the version was read
+    bool validate(uint64_t) const;
+    // makes the optimistic reads fail which started before (without locking;
+    // the page is claimed for eviction or restructuring)
+    void invalidate();
+};
+// --------------------------------------------------------------------------
+// maps page ids to buffer indices; the table is partitioned so that lookups
+// only latch a small part of it
+class PageTable {
+    private:
+    static constexpr size_t PARTITIONS = 64;
+    struct alignas(64) Partition {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint64_t, size_t> entries;
+    };
+    std::array<Partition, PARTITIONS> partitions;
+
+    private:
+    Partition& getPartition(uint64_t);
+    const Partition& getPartition(uint64_t) const;
+
+    public:
+    std::optional<size_t> find(uint64_t) const;
+    bool contains(uint64_t) const;
+    void insert(uint64_t, size_t);
+    void erase(uint64_t);
+    // calls the function with the buffer index of the page while its
+    // partition is latched; returns false if the page is not in the table
+    template <class Func>
+    bool visit(uint64_t, Func&&) const;
+};
+// --------------------------------------------------------------------------
 template <size_t PAGE_SIZE>
 struct Page {
+    // set in the pin counter while the buffer manager evicts or restructures
+    // (x-merge) the unpinned page; pins fail in the meantime
+    static constexpr size_t CLAIMED = size_t(1) << 63;
+    // id of a frame whose page couldn't be loaded
+    static constexpr uint64_t INVALID_ID = ~uint64_t(0);
     uint64_t id;
     // contention detection
     size_t updates;
@@ -30,15 +103,73 @@ struct Page {
     // buffer
     std::atomic<size_t> pinned;
     std::atomic<bool> referenced;
+    // interpreted by the replacement policy (e.g. access times)
+    std::array<std::atomic<uint64_t>, 2> policyState;
     std::atomic<bool> modified;
     std::atomic<bool> deleted;
-    std::shared_mutex mutex;
-    // frame
+    // set while the claimed frame is written back or read for a miss (without
+    // the mutex of the buffer manager); pinners of the page wait for it
+    std::atomic<bool> loading;
+    OptimisticLatch mutex;
+    // swizzling; the parent which references the page by a pointer (instead
+    // of its id) and the amount of such references stored in the page; both
+    // are maintained by the user of the buffer manager
+    std::atomic<Page*> swizzledBy;
+    std::atomic<size_t> swizzledChildren;
+    // frame; pages are read into it directly
     disk::Frame<PAGE_SIZE> frame;
-    Page(uint64_t, disk::Frame<PAGE_SIZE>);
+    explicit Page(uint64_t);
+    // pages are reused in place since swizzled pointers may still refer to
+    // them; the page has to be claimed and its frame already contains the
+    // new page, the claim is released
+    void reset(uint64_t);
+    bool tryPin();
+    // claiming invalidates the optimistic reads of the page, since its frame
+    // may be reused without its latch
+    bool tryClaim();
+    bool claimed() const;
+    void release();
+};
+// --------------------------------------------------------------------------
+struct BufferConfig {
+    // the buffer can't grow beyond this amount of frames (their address space
+    // is reserved up front); 0: the initial amount
+    size_t maxFrames = 0;
+    // writes dirty pages back before they are evicted (otherwise, the misses
+    // write them)
+    bool backgroundWriter = true;
 };
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
+// memory for the pages of the buffer in one range (on transparent huge
+// pages); address space is reserved for the maximal amount of pages, so that
+// the buffer can grow in place; the pages are constructed in it by the buffer
+// manager
+template <size_t PAGE_SIZE>
+class PageArena {
+    private:
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(1) << 21;
+    void* memory;
+    size_t size;
+    size_t capacity;
+
+    public:
+    // reserves space for the given amount of pages
+    explicit PageArena(size_t);
+    ~PageArena();
+    PageArena(const PageArena&) = delete;
+    PageArena& operator=(const PageArena&) = delete;
+    size_t maxPages() const;
+    // uninitialized memory for the page at the index
+    void* slot(size_t) const;
+    // the (constructed) page at the index
+    Page<PAGE_SIZE>* operator[](size_t) const;
+    // faults in the memory of the slots [begin, end)
+    void populate(size_t, size_t);
+    // returns the memory of the (destroyed) pages in [begin, end) to the system
+    void release(size_t, size_t);
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
 class BufferManager {
 
     private:
@@ -46,221 +177,1187 @@ class BufferManager {
     public:
 #endif
     disk::DiskManager<PAGE_SIZE> diskManager;
-    // clock
-    size_t hand;
-    std::unordered_map<uint64_t, size_t> loadedPages;
+    // usable frames; only changed while the mutex is held exclusively
+    size_t frameAmount;
+    // the frames [0, constructed) contain pages (empty ones are used first)
+    size_t constructed = 0;
+    PageTable loadedPages;
     std::unordered_set<uint64_t> innerNodes;
 
-    std::array<std::unique_ptr<Page<PAGE_SIZE>>, PAGE_AMOUNT> buffer;
+    PageArena<PAGE_SIZE> buffer;
+    std::unique_ptr<ReplacementPolicy<PAGE_SIZE>> policy;
+    // only held for misses, evictions and deletions; hits just latch the
+    // partition of the page table
     mutable std::shared_mutex mutex;
+    // misses wait here if all frames are in use; notified when a page is
+    // unpinned (only if somebody is waiting)
+    std::condition_variable_any frameReleased;
+    std::atomic<size_t> waiters = 0;
+    // resizes drain frames without holding the mutex; only one at a time
+    std::mutex resizeMutex;
+    // the function runs while the mutex is held exclusively; it has to claim
+    // the pages it restructures
     using BeforeLoadingFunc = std::function<bool(
         uint64_t,
-        std::unordered_map<uint64_t, size_t>&,
+        PageTable&,
         std::unordered_set<uint64_t>&,
-        std::array<std::unique_ptr<Page<PAGE_SIZE>>, PAGE_AMOUNT>&,
+        PageArena<PAGE_SIZE>&,
         disk::DiskManager<PAGE_SIZE>&)>;
     BeforeLoadingFunc beforeEvictingFunc;
     using IsInnerNodeFunc = std::function<bool(Page<PAGE_SIZE>*)>;
     IsInnerNodeFunc isInnerNodeFunc;
+    // replaces the pointer to the page in its parent by the page id; the
+    // parent is locked exclusively by the caller
+    using UnswizzleFunc = std::function<void(Page<PAGE_SIZE>*)>;
+    UnswizzleFunc unswizzleFunc;
+    // checks whether children of the (claimed) page are in memory
+    using ResidentChildrenFunc = std::function<bool(Page<PAGE_SIZE>*, const PageTable&)>;
+    ResidentChildrenFunc residentChildrenFunc;
+    // background writer (optional); flushes dirty pages shortly before the
+    // replacement policy evicts them (among a quarter of the frames), so that
+    // evictions don't have to write them; it sleeps until less than a quarter
+    // of the frames is clean or a miss had to write a page itself
+    const bool backgroundWriter;
+    // counted when pages become dirty (evictions don't count them down); the
+    // writer recounts them after each pass
+    std::atomic<size_t> dirtyPages = 0;
+    // the writer is woken above this amount of dirty pages
+    std::atomic<size_t> dirtyThreshold;
+    std::atomic<bool> writerRequested = false;
+    std::mutex writerMutex;
+    std::condition_variable writerWakeup;
+    bool writerStopped = false;
+    std::thread writer;
 
 // enable logging
 #ifdef LOGGING
     public:
     std::atomic<size_t> SWAPS = 0;
     std::atomic<size_t> SPECIAL_LOADS = 0;
+    std::atomic<size_t> PIN_WAITS = 0;
+    std::atomic<size_t> BACKGROUND_WRITES = 0;
+    std::atomic<size_t> MISSES = 0;
+    std::atomic<size_t> INNER_MISSES = 0;
 #endif
 
     public:
-    explicit BufferManager(const std::string&,
+    // how long a miss waits for a free frame before pinning fails (zero fails
+    // immediately); must be set before the buffer manager is used
+    std::chrono::milliseconds pinTimeout = std::chrono::milliseconds(100);
+    // inner nodes are only evicted if no leaf can be, and never while their
+    // children are in memory (requires the resident children function); must
+    // be set before the buffer manager is used
+    bool protectInnerNodes = false;
+
+    public:
+    BufferManager(const std::string&,
+                           size_t,
                            BeforeLoadingFunc beforeEvictingFunc = nullptr,
-                           IsInnerNodeFunc isInnerNodeFunc = nullptr);
+                           IsInnerNodeFunc isInnerNodeFunc = nullptr,
+                           UnswizzleFunc unswizzleFunc = nullptr,
+                           disk::IOConfig ioConfig = {},
+                           Replacement replacement = Replacement::Clock,
+                           ResidentChildrenFunc residentChildrenFunc = nullptr,
+                           BufferConfig config = {});
     ~BufferManager();
 
     private:
-    bool loadIntoMemory(uint64_t, bool);
+    // returns false if the parent of the swizzled page is busy
+    bool tryUnswizzle(Page<PAGE_SIZE>&);
+    // checks whether the claimed page may be evicted (swizzling might have
+    // happened before it was claimed)
+    bool evictable(Page<PAGE_SIZE>&) const;
+    // a frame reserved for a miss; the page is claimed and loading, the
+    // requested id is already in the page table
+    struct Reservation {
+        Page<PAGE_SIZE>* page = nullptr;
+        size_t index = 0;
+        // the evicted page is modified; until it is written back, its id
+        // stays in the page table as well
+        std::optional<uint64_t> writeBack;
+    };
+    // fails if there is no free frame; busy is set if some frames could only
+    // not be used because their latches are held; the page is either loaded
+    // right away (x-merge) or a frame is reserved
+    bool loadIntoMemory(uint64_t, bool& busy, Reservation&);
+    // reserves the frame at the index (its page is claimed if it exists)
+    void reserve(uint64_t, size_t, Reservation&);
+    // tries to evict the page of the frame at the index (or to load the page
+    // by x-merge instead)
+    bool tryEvict(uint64_t, size_t, bool& busy, Reservation&);
+    // does the I/O of the reservation (without holding the mutex) and pins
+    // the loaded page
+    Page<PAGE_SIZE>* completeLoad(uint64_t, bool, const Reservation&);
+    // the page is not loading anymore; notifies the waiting pinners
+    void finishLoading(Page<PAGE_SIZE>&);
+    void notifyWaiters();
+    // wakes the background writer (if there is one)
+    void wakeWriter();
+    // a page became dirty
+    void dirtied();
+    void runWriter();
+    // the amount of modified pages in the usable frames
+    size_t countDirtyPages() const;
+    // writes back the dirty pages which are evicted next; returns the amount
+    // of written pages
+    size_t flushAhead();
+    // evicts the page of the frame at the index, which is not used anymore
+    // (after shrinking); returns false if it is still in use; a modified page
+    // is claimed (and loading) instead, its index is appended so that it is
+    // written back without the mutex
+    bool drain(size_t, std::vector<size_t>&);
 
     public:
     size_t totalFrames() const;
+    size_t bufferFrames() const;
+    // grows or shrinks the buffer to the given amount of frames (at most the
+    // configured maximum) while it is used; shrinking evicts the pages of the
+    // removed frames (and waits until they are unpinned)
+    void resize(size_t);
+    // resizes the buffer to the amount of pages that fit into the given bytes
+    void setMemoryBudget(size_t);
+    // waits (up to the timeout) if all frames are in use; returns nullptr if
+    // there is still no free frame
     Page<PAGE_SIZE>* pinPage(uint64_t, bool initializedNode = false);
+    // reads the missing pages in one batch without pinning them (e.g. before
+    // they are pinned one after another); pages without a free frame are
+    // skipped, at most a quarter of the buffer is used; does nothing unless
+    // the disk manager batches its requests
+    void prefetch(const std::vector<uint64_t>&);
+    // pins a page which is known to be in memory (e.g. through a swizzled
+    // pointer) without consulting the page table; fails while it is claimed
+    bool pinPage(Page<PAGE_SIZE>&);
+    // the page if it is in memory, without pinning it; it may be evicted at
+    // any time, so it's only usable for optimistic reads (and pinPage(Page&))
+    Page<PAGE_SIZE>* findPage(uint64_t) const;
     void unpinPage(uint64_t, bool);
+    void unpinPage(Page<PAGE_SIZE>&, bool);
     uint64_t newPage();
-    bool deletePage(uint64_t);
+    // never waits: a resident page is only marked as deleted, its frame is
+    // reclaimed (without writing it back) once it isn't pinned anymore; late
+    // readers still find its last content meanwhile
+    void deletePage(uint64_t);
+    // the page (pinned by the caller) became an inner node or stopped being
+    // one; pages loaded as initialized nodes are classified on their own
+    void setInnerNode(uint64_t, bool);
 };
 // --------------------------------------------------------------------------
+inline OptimisticLatch::OptimisticLatch() : version(0) {
+    pthread_rwlockattr_t attributes;
+    pthread_rwlockattr_init(&attributes);
+    pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&mutex, &attributes);
+    pthread_rwlockattr_destroy(&attributes);
+}
+// --------------------------------------------------------------------------
+inline OptimisticLatch::~OptimisticLatch() {
+    pthread_rwlock_destroy(&mutex);
+}
+// --------------------------------------------------------------------------
+inline PageTable::Partition& PageTable::getPartition(uint64_t id) {
+    return partitions[id % PARTITIONS];
+}
+// --------------------------------------------------------------------------
+inline const PageTable::Partition& PageTable::getPartition(uint64_t id) const {
+    return partitions[id % PARTITIONS];
+}
+// --------------------------------------------------------------------------
+inline std::optional<size_t> PageTable::find(uint64_t id) const {
+    const Partition& partition = getPartition(id);
+    std::shared_lock lock(partition.mutex);
+    auto it = partition.entries.find(id);
+    if (it == partition.entries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+// --------------------------------------------------------------------------
+inline bool PageTable::contains(uint64_t id) const {
+    return find(id).has_value();
+}
+// --------------------------------------------------------------------------
+inline void PageTable::insert(uint64_t id, size_t index) {
+    Partition& partition = getPartition(id);
+    std::unique_lock lock(partition.mutex);
+    partition.entries[id] = index;
+}
+// --------------------------------------------------------------------------
+inline void PageTable::erase(uint64_t id) {
+    Partition& partition = getPartition(id);
+    std::unique_lock lock(partition.mutex);
+    partition.entries.erase(id);
+}
+// --------------------------------------------------------------------------
+template <class Func>
+bool PageTable::visit(uint64_t id, Func&& func) const {
+    const Partition& partition = getPartition(id);
+    std::shared_lock lock(partition.mutex);
+    auto it = partition.entries.find(id);
+    if (it == partition.entries.end()) {
+        return false;
+    }
+    func(it->second);
+    return true;
+}
+// --------------------------------------------------------------------------
+inline void OptimisticLatch::lock() {
+    pthread_rwlock_wrlock(&mutex);
+    version.fetch_add(1, std::memory_order_acq_rel);
+}
+// --------------------------------------------------------------------------
+inline bool OptimisticLatch::try_lock() {
+    if (pthread_rwlock_trywrlock(&mutex) != 0) {
+        return false;
+    }
+    version.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+// --------------------------------------------------------------------------
+inline void OptimisticLatch::unlock() {
+    version.fetch_add(1, std::memory_order_release);
+    pthread_rwlock_unlock(&mutex);
+}
+// --------------------------------------------------------------------------
+inline void OptimisticLatch::lock_shared() {
+    pthread_rwlock_rdlock(&mutex);
+}
+// --------------------------------------------------------------------------
+inline bool OptimisticLatch::try_lock_shared() {
+    return pthread_rwlock_tryrdlock(&mutex) == 0;
+}
+// --------------------------------------------------------------------------
+inline void OptimisticLatch::unlock_shared() {
+    pthread_rwlock_unlock(&mutex);
+}
+// --------------------------------------------------------------------------
+inline bool OptimisticLatch::tryUpgrade(uint64_t expected) {
+    if (!try_lock()) {
+        return false;
+    }
+    if (version.load(std::memory_order_relaxed) != expected + 1) {
+        unlock();
+        return false;
+    }
+    return true;
+}
+// --------------------------------------------------------------------------
+inline uint64_t OptimisticLatch::readVersion() {
+    // if a writer is active, yield until it is done (sleeping on the latch
+    // would make every writer wake up all waiting readers)
+    uint64_t current;
+    while ((current = version.load(std::memory_order_acquire)) & 1) {
+        std::this_thread::yield();
+    }
+    return current;
+}
+// --------------------------------------------------------------------------
+inline bool OptimisticLatch::validate(uint64_t expected) const {
+    // order the preceding (optimistic) reads before the version check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.load(std::memory_order_relaxed) == expected;
+}
+// --------------------------------------------------------------------------
+inline void OptimisticLatch::invalidate() {
+    // by two, so that a held latch stays odd
+    version.fetch_add(2, std::memory_order_acq_rel);
+}
+// --------------------------------------------------------------------------
 template <size_t PAGE_SIZE>
-Page<PAGE_SIZE>::Page(uint64_t id, disk::Frame<PAGE_SIZE> frame)
+Page<PAGE_SIZE>::Page(uint64_t id)
     : id(id), updates(0), slowPaths(0), lastUpdatesPos(0), pinned(0),
-      referenced(true), modified(false), deleted(false), frame(std::move(frame)) {
+      referenced(true), modified(false), deleted(false), loading(false), swizzledBy(nullptr), swizzledChildren(0) {
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-BufferManager<PAGE_AMOUNT, PAGE_SIZE>::BufferManager(
-    const std::string& filePath, BeforeLoadingFunc beforeEvictingFunc, IsInnerNodeFunc isInnerNodeFunc)
-    : diskManager(filePath), hand(0),
-      beforeEvictingFunc(std::move(beforeEvictingFunc)), isInnerNodeFunc(std::move(isInnerNodeFunc)) {
+template <size_t PAGE_SIZE>
+void Page<PAGE_SIZE>::reset(uint64_t newID) {
+    assert(pinned & CLAIMED);
+    assert(!swizzledBy && swizzledChildren == 0);
+    id = newID;
+    updates = 0;
+    slowPaths = 0;
+    lastUpdatesPos = 0;
+    referenced = true;
+    modified = false;
+    deleted = false;
+    release();
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-BufferManager<PAGE_AMOUNT, PAGE_SIZE>::~BufferManager() {
-    for (auto& page : buffer) {
-        if (!page) {
-            continue;
+template <size_t PAGE_SIZE>
+bool Page<PAGE_SIZE>::tryPin() {
+    if (pinned.fetch_add(1) & CLAIMED) {
+        pinned.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool Page<PAGE_SIZE>::tryClaim() {
+    size_t expected = 0;
+    if (!pinned.compare_exchange_strong(expected, CLAIMED)) {
+        return false;
+    }
+    mutex.invalidate();
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool Page<PAGE_SIZE>::claimed() const {
+    return pinned.load(std::memory_order_acquire) & CLAIMED;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void Page<PAGE_SIZE>::release() {
+    // failed pins might not have been reverted yet
+    pinned.fetch_sub(CLAIMED);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+PageArena<PAGE_SIZE>::PageArena(size_t pageAmount) : capacity(pageAmount) {
+    size = (capacity * sizeof(Page<PAGE_SIZE>) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    // nothing is committed until the frames are populated
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("couldn't allocate buffer");
+    }
+    madvise(memory, size, MADV_HUGEPAGE);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+PageArena<PAGE_SIZE>::~PageArena() {
+    munmap(memory, size);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+size_t PageArena<PAGE_SIZE>::maxPages() const {
+    return capacity;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void* PageArena<PAGE_SIZE>::slot(size_t index) const {
+    return static_cast<char*>(memory) + index * sizeof(Page<PAGE_SIZE>);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+Page<PAGE_SIZE>* PageArena<PAGE_SIZE>::operator[](size_t index) const {
+    return std::launder(static_cast<Page<PAGE_SIZE>*>(slot(index)));
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void PageArena<PAGE_SIZE>::populate([[maybe_unused]] size_t begin, [[maybe_unused]] size_t end) {
+#ifdef MADV_POPULATE_WRITE
+    // fault everything in now instead of during the misses
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t from = begin * sizeof(Page<PAGE_SIZE>) / pageSize * pageSize;
+    const size_t to = end * sizeof(Page<PAGE_SIZE>);
+    if (from < to) {
+        madvise(static_cast<char*>(memory) + from, to - from, MADV_POPULATE_WRITE);
+    }
+#endif
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void PageArena<PAGE_SIZE>::release(size_t begin, size_t end) {
+    // only whole pages which don't overlap with the remaining slots; the
+    // range stays mapped, so that stale pointers can't fault
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t from = (begin * sizeof(Page<PAGE_SIZE>) + pageSize - 1) / pageSize * pageSize;
+    const size_t to = end * sizeof(Page<PAGE_SIZE>) / pageSize * pageSize;
+    if (from < to) {
+        madvise(static_cast<char*>(memory) + from, to - from, MADV_DONTNEED);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+BufferManager<PAGE_SIZE>::BufferManager(
+    const std::string& filePath, size_t frameAmount, BeforeLoadingFunc beforeEvictingFunc,
+    IsInnerNodeFunc isInnerNodeFunc, UnswizzleFunc unswizzleFunc, disk::IOConfig ioConfig,
+    Replacement replacement, ResidentChildrenFunc residentChildrenFunc, BufferConfig config)
+    : diskManager(filePath, ioConfig), frameAmount(frameAmount),
+      buffer(config.maxFrames != 0 ? config.maxFrames : frameAmount),
+      policy(makePolicy<PAGE_SIZE>(replacement, buffer, frameAmount,
+                                   [this](Page<PAGE_SIZE>& page) { return tryUnswizzle(page); })),
+      beforeEvictingFunc(std::move(beforeEvictingFunc)), isInnerNodeFunc(std::move(isInnerNodeFunc)),
+      unswizzleFunc(std::move(unswizzleFunc)), residentChildrenFunc(std::move(residentChildrenFunc)),
+      backgroundWriter(config.backgroundWriter), dirtyThreshold(frameAmount - frameAmount / 4) {
+    if (frameAmount == 0 || frameAmount > buffer.maxPages()) {
+        throw std::runtime_error("invalid buffer size");
+    }
+    buffer.populate(0, frameAmount);
+    if (backgroundWriter) {
+        writer = std::thread(&BufferManager::runWriter, this);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+BufferManager<PAGE_SIZE>::~BufferManager() {
+    {
+        std::lock_guard lock(writerMutex);
+        writerStopped = true;
+    }
+    writerWakeup.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    // only ids are persisted
+    for (size_t i = 0; i < constructed; i++) {
+        if (buffer[i]->swizzledBy) {
+            unswizzleFunc(buffer[i]);
         }
+    }
+    for (size_t i = 0; i < constructed; i++) {
+        auto* page = buffer[i];
         if (page->deleted) {
             diskManager.deletePage(page->id);
         } else if (page->modified) {
             diskManager.writePage(page->id, page->frame);
         }
+        std::destroy_at(page);
     }
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-bool BufferManager<PAGE_AMOUNT, PAGE_SIZE>::loadIntoMemory(uint64_t id, bool initializedNode) {
-    // function to load page
-    const static auto loadPage = [](BufferManager<PAGE_AMOUNT, PAGE_SIZE>& tree,
-                                    uint64_t id, bool initializedNode) {
-        auto page = std::make_unique<Page<PAGE_SIZE>>(
-            id, std::move(tree.diskManager.retrievePage(id)));
-        auto* pagePointer = page.get();
-        // store it
-        tree.buffer[tree.hand] = std::move(page);
-        tree.loadedPages[id] = tree.hand;
-        //
-        tree.hand = (tree.hand + 1) % PAGE_AMOUNT;
-        if(initializedNode && tree.isInnerNodeFunc && id != 0){
-            if(tree.isInnerNodeFunc(pagePointer)){
-                tree.innerNodes.insert(id);
+template <size_t PAGE_SIZE>
+bool BufferManager<PAGE_SIZE>::tryUnswizzle(Page<PAGE_SIZE>& page) {
+    Page<PAGE_SIZE>* parent = page.swizzledBy;
+    if (!parent) {
+        return true;
+    }
+    // the parent can't be evicted while it has swizzled children (pages are
+    // never freed anyway); don't wait for it since its owner might wait for us
+    if (!parent->mutex.try_lock()) {
+        return false;
+    }
+    // it might have been unswizzled in the meantime
+    if (page.swizzledBy == parent) {
+        unswizzleFunc(&page);
+    }
+    parent->mutex.unlock();
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool BufferManager<PAGE_SIZE>::evictable(Page<PAGE_SIZE>& page) const {
+    assert(page.pinned & Page<PAGE_SIZE>::CLAIMED);
+    return !page.swizzledBy && page.swizzledChildren == 0;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool BufferManager<PAGE_SIZE>::loadIntoMemory(uint64_t id, bool& busy, Reservation& reservation) {
+    if (constructed < frameAmount) {
+        // empty, can be used
+        reserve(id, constructed, reservation);
+        return true;
+    }
+    policy->begin(frameAmount);
+    // inner nodes are tried after all other candidates (the search of the
+    // policy is bounded, but might return a frame more than once)
+    std::vector<size_t> innerCandidates;
+    std::unordered_set<size_t> deferred;
+    size_t index;
+    while (policy->next(index)) {
+        if (protectInnerNodes && innerNodes.contains(buffer[index]->id)) {
+            if (deferred.insert(index).second) {
+                innerCandidates.push_back(index);
             }
+            continue;
         }
-    };
-    size_t encounters = 0;
-    bool foundUnpinned = false;
-    while (!(encounters >= PAGE_AMOUNT && !foundUnpinned)) {
-        if (!buffer[hand]) {
-            // empty, can be used
-            loadPage(*this, id, initializedNode);
+        if (tryEvict(id, index, busy, reservation)) {
+            return true;
+        }
+    }
+    for (size_t inner : innerCandidates) {
+        if (tryEvict(id, inner, busy, reservation)) {
             return true;
-        } else if (buffer[hand]->pinned == 0) {
-            if (buffer[hand]->deleted || !buffer[hand]->referenced) {
-                // a page will be evicted; try out the custom
-                // loading strategy (x-merge) before that
-                if (beforeEvictingFunc &&
-                    beforeEvictingFunc(
-                        id, loadedPages, innerNodes, buffer, diskManager)) {
+        }
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::reserve(uint64_t id, size_t index, Reservation& reservation) {
+    Page<PAGE_SIZE>* page;
+    if (index == constructed) {
+        page = new (buffer.slot(index)) Page<PAGE_SIZE>(id);
+        constructed++;
+        [[maybe_unused]] const bool claimed = page->tryClaim();
+        assert(claimed);
+    } else {
+        page = buffer[index];
+    }
+    // pinners wait until the I/O is done
+    page->loading = true;
+    reservation.page = page;
+    reservation.index = index;
+    loadedPages.insert(id, index);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool BufferManager<PAGE_SIZE>::tryEvict(uint64_t id, size_t index, bool& busy, Reservation& reservation) {
+    auto& p = *buffer[index];
+    // (parents of swizzled pages stay in memory)
+    if (p.pinned != 0 || p.swizzledChildren != 0) {
+        return false;
+    }
+    if (!p.deleted && !tryUnswizzle(p)) {
+        busy = true;
+        return false;
+    }
+    // a page will be evicted; try out the custom loading strategy (x-merge)
+    // before that
+    if (beforeEvictingFunc &&
+        beforeEvictingFunc(
+            id, loadedPages, innerNodes, buffer, diskManager)) {
 #ifdef LOGGING
-                    SPECIAL_LOADS++;
+        SPECIAL_LOADS++;
+        MISSES++;
 #endif
-                    return true;
-                }
+        loadedPages.visit(id, [&](size_t loadedIndex) { policy->loaded(loadedIndex, id); });
+        return true;
+    }
+    // pins fail from now on
+    if (!p.tryClaim()) {
+        return false;
+    }
+    if (p.deleted) {
+        // page was deleted, can be used (late readers might still pin it
+        // through a stale pointer, but they fail since it's claimed)
+        policy->evicted(index, p);
+        loadedPages.erase(p.id);
+        diskManager.deletePage(p.id);
+        reserve(id, index, reservation);
+        return true;
+    }
+    // (the content can be read safely while the page is claimed)
+    if (!evictable(p) || (protectInnerNodes && residentChildrenFunc && residentChildrenFunc(&p, loadedPages))) {
+        p.release();
+        return false;
+    }
+    if (p.modified) {
+        // written back after the mutex is released (the background writer is
+        // behind); the policy learns about the eviction once that succeeded
+        reservation.writeBack = p.id;
+    } else {
+        policy->evicted(index, p);
+        loadedPages.erase(p.id);
+        innerNodes.erase(p.id); // does nothing if it's not an inner node
+    }
+    reserve(id, index, reservation);
+#ifdef LOGGING
+    SWAPS++;
+#endif
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+Page<PAGE_SIZE>* BufferManager<PAGE_SIZE>::completeLoad(uint64_t id, bool initializedNode,
+                                                                     const Reservation& reservation) {
+    auto& page = *reservation.page;
+    if (reservation.writeBack) {
+        try {
+            diskManager.writePage(*reservation.writeBack, page.frame);
+        } catch (...) {
+            // the page stays in memory (and modified)
+            {
+                std::unique_lock lock(mutex);
+                loadedPages.erase(id);
             }
-            foundUnpinned = true;
-            if (buffer[hand]->deleted) {
-                // page was deleted, can be used
-                auto& p = *buffer[hand];
-                diskManager.deletePage(p.id);
-                // use it
-                loadPage(*this, id, initializedNode);
-                return true;
-            } else if (!buffer[hand]->referenced) {
-                // not referenced, can be used
-                auto& p = *buffer[hand];
-                // write back if modified
-                if (p.modified) {
-                    diskManager.writePage(p.id, p.frame);
-                }
-                loadedPages.erase(p.id);
-                innerNodes.erase(p.id); // does nothing if it's not an inner node
-                // use it
-                loadPage(*this, id, initializedNode);
+            page.release();
+            finishLoading(page);
+            throw;
+        }
+        // the writer didn't keep up
+        wakeWriter();
+        // only now, the page may be read by a miss
+        std::unique_lock lock(mutex);
+        loadedPages.erase(*reservation.writeBack);
+        innerNodes.erase(*reservation.writeBack);
+        policy->evicted(reservation.index, page);
+    }
+    try {
+        diskManager.readPage(id, page.frame);
+    } catch (...) {
+        // the frame is free again; waiting pinners try it themselves
+        {
+            std::unique_lock lock(mutex);
+            loadedPages.erase(id);
+        }
+        page.reset(Page<PAGE_SIZE>::INVALID_ID);
+        finishLoading(page);
+        throw;
+    }
 #ifdef LOGGING
-                SWAPS++;
+    MISSES++;
 #endif
-                return true;
-            } else {
-                // second chance
-                buffer[hand]->referenced = false;
+    const bool innerNode = initializedNode && isInnerNodeFunc && isInnerNodeFunc(&page);
+#ifdef LOGGING
+    if (innerNode) {
+        INNER_MISSES++;
+    }
+#endif
+    {
+        // (after a failed load, the policy never saw the page)
+        std::unique_lock lock(mutex);
+        policy->loaded(reservation.index, id);
+        if (innerNode) {
+            innerNodes.insert(id);
+        }
+    }
+    // the claim becomes a pin
+    page.pinned++;
+    page.reset(id);
+    finishLoading(page);
+    return &page;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::finishLoading(Page<PAGE_SIZE>& page) {
+    page.loading = false;
+    page.loading.notify_all();
+    // the frame might be usable again
+    if (page.pinned == 0 && waiters > 0) {
+        notifyWaiters();
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::notifyWaiters() {
+    // a waiter holds the mutex until it sleeps; this way, the notification
+    // can't get lost in between
+    { std::shared_lock lock(mutex); }
+    frameReleased.notify_all();
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::wakeWriter() {
+    if (!backgroundWriter || writerRequested.exchange(true)) {
+        return;
+    }
+    // the writer holds the mutex until it sleeps; this way, the notification
+    // can't get lost in between
+    { std::lock_guard lock(writerMutex); }
+    writerWakeup.notify_one();
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::dirtied() {
+    // only when crossing the watermark; if the writer can't get below it,
+    // the misses writing pages themselves wake it
+    if (dirtyPages.fetch_add(1) == dirtyThreshold) {
+        wakeWriter();
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::runWriter() {
+    std::unique_lock lock(writerMutex);
+    while (true) {
+        writerWakeup.wait(lock, [this] { return writerRequested || writerStopped; });
+        if (writerStopped) {
+            break;
+        }
+        writerRequested = false;
+        lock.unlock();
+        // pass after pass until enough frames are clean again (or nothing
+        // can be written right now)
+        while (true) {
+            const size_t written = flushAhead();
+            const size_t dirty = countDirtyPages();
+            dirtyPages = dirty;
+            if (written == 0 || dirty <= dirtyThreshold) {
+                break;
             }
         }
-        encounters++;
-        hand = (hand + 1) % PAGE_AMOUNT;
+        lock.lock();
     }
-    return false;
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-size_t BufferManager<PAGE_AMOUNT, PAGE_SIZE>::totalFrames() const {
-    return diskManager.entryAmount();
+template <size_t PAGE_SIZE>
+size_t BufferManager<PAGE_SIZE>::countDirtyPages() const {
+    std::shared_lock lock(mutex);
+    size_t dirty = 0;
+    for (size_t i = 0; i < std::min(constructed, frameAmount); i++) {
+        if (buffer[i]->modified && !buffer[i]->deleted) {
+            dirty++;
+        }
+    }
+    return dirty;
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-Page<PAGE_SIZE>* BufferManager<PAGE_AMOUNT, PAGE_SIZE>::pinPage(uint64_t id, bool initializedNode) {
+template <size_t PAGE_SIZE>
+size_t BufferManager<PAGE_SIZE>::flushAhead() {
+    // pin the candidates, so that they can't be evicted (or reused) while
+    // they are written
+    std::vector<Page<PAGE_SIZE>*> candidates;
     {
         std::shared_lock lock(mutex);
-        // check if the page is in memory
-        if (loadedPages.contains(id)) {
-            auto* page = buffer[loadedPages[id]].get();
-            page->pinned++;
-            page->referenced = true;
-            return page;
+        std::vector<size_t> upcoming;
+        policy->upcoming(std::min(constructed, frameAmount), frameAmount / 4 + 1, upcoming);
+        for (size_t index : upcoming) {
+            auto* page = buffer[index];
+            if (!page->modified || page->deleted || page->pinned != 0) {
+                continue;
+            }
+            if (page->tryPin()) {
+                candidates.push_back(page);
+            }
+        }
+    }
+    std::vector<disk::Frame<PAGE_SIZE>> frames(candidates.size());
+    std::vector<Page<PAGE_SIZE>*> copied;
+    std::vector<std::pair<uint64_t, const disk::Frame<PAGE_SIZE>*>> writes;
+    for (auto* page : candidates) {
+        // writers hold the latch exclusively; copy the content, so that they
+        // aren't blocked during the write
+        if (page->mutex.try_lock_shared()) {
+            // swizzled pointers must not reach the disk (swizzling requires
+            // the latch exclusively); the flag is cleared before copying, so
+            // that later modifications mark the page again
+            if (page->swizzledChildren == 0 && page->modified.exchange(false)) {
+                frames[copied.size()] = page->frame;
+                writes.emplace_back(page->id, &frames[copied.size()]);
+                copied.push_back(page);
+            }
+            page->mutex.unlock_shared();
         }
-        // destructor unlocks lock
     }
-    // request exclusive permissions
+    // all pages are submitted at once
+    size_t written = 0;
+    if (!writes.empty()) {
+        try {
+            diskManager.writePages(writes);
+            written = writes.size();
+        } catch (const std::exception&) {
+            // the eviction tries it again
+            for (auto* page : copied) {
+                page->modified = true;
+            }
+        }
+    }
+    for (auto* page : candidates) {
+        unpinPage(*page, false);
+    }
+#ifdef LOGGING
+    BACKGROUND_WRITES += written;
+#endif
+    return written;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+size_t BufferManager<PAGE_SIZE>::totalFrames() const {
+    return diskManager.entryAmount();
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+size_t BufferManager<PAGE_SIZE>::bufferFrames() const {
+    std::shared_lock lock(mutex);
+    return frameAmount;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool BufferManager<PAGE_SIZE>::drain(size_t index, std::vector<size_t>& writeBacks) {
+    auto& page = *buffer[index];
+    if (page.id == Page<PAGE_SIZE>::INVALID_ID) {
+        if (page.pinned != 0) {
+            return false;
+        }
+        policy->evicted(index, page);
+        return true;
+    }
+    if (page.pinned != 0) {
+        return false;
+    }
+    if (page.swizzledChildren > 0) {
+        // the children are somewhere in the buffer
+        for (size_t i = 0; i < constructed; i++) {
+            if (buffer[i]->swizzledBy == &page) {
+                tryUnswizzle(*buffer[i]);
+            }
+        }
+        return false;
+    }
+    if (!page.deleted && !tryUnswizzle(page)) {
+        return false;
+    }
+    if (!page.tryClaim()) {
+        return false;
+    }
+    if (!evictable(page)) {
+        page.release();
+        return false;
+    }
+    if (!page.deleted && page.modified) {
+        // pinners wait for it like for a miss
+        page.loading = true;
+        writeBacks.push_back(index);
+        return true;
+    }
+    policy->evicted(index, page);
+    if (page.deleted) {
+        // (its content is dropped)
+        diskManager.deletePage(page.id);
+    }
+    loadedPages.erase(page.id);
+    innerNodes.erase(page.id);
+    page.reset(Page<PAGE_SIZE>::INVALID_ID);
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::resize(size_t newFrameAmount) {
+    if (newFrameAmount == 0 || newFrameAmount > buffer.maxPages()) {
+        throw std::runtime_error("invalid buffer size");
+    }
+    std::lock_guard resizeLock(resizeMutex);
     std::unique_lock lock(mutex);
-    // check again if the page is in memory
-    if (loadedPages.contains(id)) {
-        auto* page = buffer[loadedPages[id]].get();
-        page->pinned++;
-        page->referenced = true;
+    if (newFrameAmount >= frameAmount) {
+        buffer.populate(frameAmount, newFrameAmount);
+        frameAmount = newFrameAmount;
+        dirtyThreshold = frameAmount - frameAmount / 4;
+        // misses waiting for a frame can use the new ones
+        frameReleased.notify_all();
+        return;
+    }
+    // misses only use the remaining frames from now on
+    const size_t oldFrameAmount = frameAmount;
+    frameAmount = newFrameAmount;
+    dirtyThreshold = frameAmount - frameAmount / 4;
+    // the pages beyond are drained while they aren't pinned; unpins notify
+    // us, released latches don't
+    waiters++;
+    while (true) {
+        bool drained = true;
+        std::vector<size_t> writeBacks;
+        for (size_t i = frameAmount; i < constructed; i++) {
+            drained = drain(i, writeBacks) && drained;
+        }
+        if (!writeBacks.empty()) {
+            // the modified pages are written in one batch without the mutex
+            // (misses don't use these frames anymore)
+            lock.unlock();
+            std::vector<std::pair<uint64_t, const disk::Frame<PAGE_SIZE>*>> writes;
+            for (size_t i : writeBacks) {
+                writes.emplace_back(buffer[i]->id, &buffer[i]->frame);
+            }
+            bool written = true;
+            try {
+                diskManager.writePages(writes);
+            } catch (...) {
+                written = false;
+            }
+            lock.lock();
+            for (size_t i : writeBacks) {
+                auto& page = *buffer[i];
+                if (written) {
+                    policy->evicted(i, page);
+                    loadedPages.erase(page.id);
+                    innerNodes.erase(page.id);
+                    page.reset(Page<PAGE_SIZE>::INVALID_ID);
+                } else {
+                    // the page stays in memory (and modified)
+                    page.release();
+                }
+            }
+            if (!written) {
+                // the frames stay in use
+                frameAmount = oldFrameAmount;
+                dirtyThreshold = frameAmount - frameAmount / 4;
+                waiters--;
+            }
+            lock.unlock();
+            for (size_t i : writeBacks) {
+                finishLoading(*buffer[i]);
+            }
+            if (!written) {
+                throw std::runtime_error("couldn't write page");
+            }
+            lock.lock();
+        }
+        if (drained) {
+            break;
+        }
+        frameReleased.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    waiters--;
+    if (constructed > frameAmount) {
+        for (size_t i = frameAmount; i < constructed; i++) {
+            std::destroy_at(buffer[i]);
+        }
+        buffer.release(frameAmount, constructed);
+        constructed = frameAmount;
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::setMemoryBudget(size_t bytes) {
+    resize(bytes / sizeof(Page<PAGE_SIZE>));
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+Page<PAGE_SIZE>* BufferManager<PAGE_SIZE>::pinPage(uint64_t id, bool initializedNode) {
+    Page<PAGE_SIZE>* page = nullptr;
+    // check if the page is in memory (it can't be evicted while the partition is latched)
+    loadedPages.visit(id, [&](size_t index) {
+        if (buffer[index]->tryPin()) {
+            page = buffer[index];
+        }
+    });
+    if (page) {
+        policy->accessed(*page);
         return page;
     }
-    // load into memory
-    if (!loadIntoMemory(id, initializedNode)) {
-        return nullptr;
+    // the page is missing or claimed; request exclusive permissions
+    std::unique_lock lock(mutex);
+    const auto deadline = std::chrono::steady_clock::now() + pinTimeout;
+    bool waiting = false;
+    while (true) {
+        // check again if the page is in memory (while the mutex is held, only
+        // loading pages are claimed)
+        bool loading = false;
+        const bool found = loadedPages.visit(id, [&](size_t index) {
+            page = buffer[index];
+            if (!page->tryPin()) {
+                assert(page->loading);
+                loading = true;
+            }
+        });
+        if (loading) {
+            // wait for this frame only (it might hold another page afterwards)
+            lock.unlock();
+            page->loading.wait(true);
+            lock.lock();
+            continue;
+        }
+        if (found) {
+            if (waiting) {
+                waiters--;
+            }
+            policy->accessed(*page);
+            return page;
+        }
+        // load into memory
+        bool busy = false;
+        Reservation reservation;
+        if (loadIntoMemory(id, busy, reservation)) {
+            if (waiting) {
+                waiters--;
+            }
+            if (!reservation.page) {
+                // loaded by x-merge
+                break;
+            }
+            lock.unlock();
+            return completeLoad(id, initializedNode, reservation);
+        }
+        if (pinTimeout.count() == 0 || std::chrono::steady_clock::now() >= deadline) {
+            if (waiting) {
+                waiters--;
+            }
+            return nullptr;
+        }
+        if (busy) {
+            // a frame becomes usable once a latch is released; that isn't
+            // notified, so back off instead of sleeping
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            continue;
+        }
+        if (!waiting) {
+            // pages unpinned from now on notify us; the ones unpinned during
+            // the first attempt are found by the second one
+            waiting = true;
+            waiters++;
+            continue;
+        }
+        // all frames are in use; sleep until one is unpinned (the mutex is
+        // released in the meantime, so the page might be loaded by somebody else)
+#ifdef LOGGING
+        PIN_WAITS++;
+#endif
+        if (frameReleased.wait_until(lock, deadline) == std::cv_status::timeout) {
+            waiters--;
+            return nullptr;
+        }
     }
-    auto* page = buffer[loadedPages[id]].get();
-    page->pinned++;
+    loadedPages.visit(id, [&](size_t index) {
+        page = buffer[index];
+        page->pinned++;
+    });
     return page;
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-void BufferManager<PAGE_AMOUNT, PAGE_SIZE>::unpinPage(uint64_t id, bool modified) {
-    std::shared_lock lock(mutex);
-    // check if the page is still in memory
-    if (!loadedPages.contains(id)) {
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::prefetch(const std::vector<uint64_t>& ids) {
+    if (!diskManager.batched()) {
+        return;
+    }
+    std::vector<std::pair<uint64_t, Reservation>> reservations;
+    {
+        std::unique_lock lock(mutex);
+        const size_t limit = frameAmount / 4;
+        for (uint64_t id : ids) {
+            if (reservations.size() == limit) {
+                break;
+            }
+            // (duplicates are in the table after their reservation)
+            if (loadedPages.contains(id)) {
+                continue;
+            }
+            bool busy = false;
+            Reservation reservation;
+            if (!loadIntoMemory(id, busy, reservation)) {
+                break;
+            }
+            if (reservation.page) {
+                reservations.emplace_back(id, reservation);
+            }
+        }
+    }
+    if (reservations.empty()) {
         return;
     }
-    auto& page = *buffer[loadedPages[id]];
-    if (modified) {
-        page.modified = true;
+    // the frames are freed (without loading) if the I/O fails
+    const auto abort = [&]() {
+        std::unique_lock lock(mutex);
+        for (auto& [id, reservation] : reservations) {
+            auto& page = *reservation.page;
+            loadedPages.erase(id);
+            if (reservation.writeBack) {
+                // the evicted page stays in memory (and modified)
+                page.release();
+            } else {
+                page.reset(Page<PAGE_SIZE>::INVALID_ID);
+            }
+        }
+        lock.unlock();
+        for (auto& [id, reservation] : reservations) {
+            finishLoading(*reservation.page);
+        }
+    };
+    // the evicted dirty pages are written back in one batch
+    std::vector<std::pair<uint64_t, const disk::Frame<PAGE_SIZE>*>> writes;
+    for (auto& [id, reservation] : reservations) {
+        if (reservation.writeBack) {
+            writes.emplace_back(*reservation.writeBack, &reservation.page->frame);
+        }
+    }
+    if (!writes.empty()) {
+        try {
+            diskManager.writePages(writes);
+        } catch (...) {
+            abort();
+            throw;
+        }
+        wakeWriter();
+        std::unique_lock lock(mutex);
+        for (auto& [id, reservation] : reservations) {
+            if (reservation.writeBack) {
+                loadedPages.erase(*reservation.writeBack);
+                innerNodes.erase(*reservation.writeBack);
+                policy->evicted(reservation.index, *reservation.page);
+                reservation.writeBack.reset();
+            }
+        }
+    }
+    std::vector<std::pair<uint64_t, disk::Frame<PAGE_SIZE>*>> reads;
+    for (auto& [id, reservation] : reservations) {
+        reads.emplace_back(id, &reservation.page->frame);
+    }
+    try {
+        diskManager.readPages(reads);
+    } catch (...) {
+        abort();
+        throw;
+    }
+#ifdef LOGGING
+    MISSES += reservations.size();
+#endif
+    {
+        std::unique_lock lock(mutex);
+        for (auto& [id, reservation] : reservations) {
+            policy->loaded(reservation.index, id);
+        }
+    }
+    for (auto& [id, reservation] : reservations) {
+        // the claim is released without a pin
+        reservation.page->reset(id);
+        finishLoading(*reservation.page);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool BufferManager<PAGE_SIZE>::pinPage(Page<PAGE_SIZE>& page) {
+    if (!page.tryPin()) {
+        return false;
+    }
+    policy->accessed(page);
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+Page<PAGE_SIZE>* BufferManager<PAGE_SIZE>::findPage(uint64_t id) const {
+    const std::optional<size_t> index = loadedPages.find(id);
+    return index ? buffer[*index] : nullptr;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::unpinPage(Page<PAGE_SIZE>& page, bool modified) {
+    if (modified && !page.modified && !page.modified.exchange(true)) {
+        dirtied();
     }
     assert(page.pinned != 0);
-    page.pinned--;
+    if (page.pinned.fetch_sub(1) == 1 && waiters > 0) {
+        notifyWaiters();
+    }
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-uint64_t BufferManager<PAGE_AMOUNT, PAGE_SIZE>::newPage() {
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::unpinPage(uint64_t id, bool modified) {
+    // the page is still in memory since it is pinned
+    bool released = false;
+    loadedPages.visit(id, [&](size_t index) {
+        auto& page = *buffer[index];
+        if (modified && !page.modified && !page.modified.exchange(true)) {
+            dirtied();
+        }
+        assert(page.pinned != 0);
+        released = page.pinned.fetch_sub(1) == 1;
+    });
+    if (released && waiters > 0) {
+        notifyWaiters();
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+uint64_t BufferManager<PAGE_SIZE>::newPage() {
     uint64_t id = diskManager.createPage().first;
     return id;
 }
 // --------------------------------------------------------------------------
-template <size_t PAGE_AMOUNT, size_t PAGE_SIZE>
-bool BufferManager<PAGE_AMOUNT, PAGE_SIZE>::deletePage(uint64_t id) {
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::deletePage(uint64_t id) {
     std::unique_lock lock(mutex);
     // check if the page is in memory
-    if (loadedPages.contains(id)) {
-        auto& page = *buffer[loadedPages[id]];
-        // only unpinned pages may be deleted
-        if (page.pinned == 0) {
-            page.deleted = true;
-            loadedPages.erase(page.id);
-            innerNodes.erase(page.id);
-            return true;
-        }
-        return false;
+    if (const std::optional<size_t> index = loadedPages.find(id)) {
+        // stays in the page table until the frame is reused, so that the id
+        // isn't loaded (and handed out) a second time meanwhile
+        buffer[*index]->deleted = true;
+        innerNodes.erase(id);
+        return;
     }
     diskManager.deletePage(id);
-    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void BufferManager<PAGE_SIZE>::setInnerNode(uint64_t id, bool inner) {
+    std::unique_lock lock(mutex);
+    // (only resident pages are registered)
+    assert(loadedPages.contains(id));
+    if (inner) {
+        innerNodes.insert(id);
+    } else {
+        innerNodes.erase(id);
+    }
 }
 // --------------------------------------------------------------------------
 } // namespace buffer
@@ -1,141 +1,345 @@
 #ifndef BTREE_DISKMANAGER_H
 #define BTREE_DISKMANAGER_H
 // --------------------------------------------------------------------------
+#include "IoUring.h"
+#include <algorithm>
 #include <array>
 #include <cinttypes>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <shared_mutex>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 // --------------------------------------------------------------------------
 namespace disk {
 // --------------------------------------------------------------------------
+// direct I/O transfers whole (logical) sectors from and to aligned buffers
+static constexpr size_t DIRECT_IO_ALIGNMENT = 512;
+// --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
-struct __attribute__((packed)) Frame {
+struct Frame {
+    // whether the content can be transferred with direct I/O as is (otherwise
+    // a bounce buffer is used)
+    static constexpr bool ALIGNED = BLOCK_SIZE > 0 && BLOCK_SIZE % DIRECT_IO_ALIGNMENT == 0;
     // actual data
-    alignas(max_align_t) std::array<char, BLOCK_SIZE> content = {};
-    // determines whether the Frame is used (1) or free (0)
-    bool used = false;
-    // if the frame is free, it contains a pointer (uint64_t) to the next
-    // free frame
-    uint64_t nextFreeFrame = 0;
+    alignas(ALIGNED ? DIRECT_IO_ALIGNMENT : alignof(std::max_align_t)) std::array<char, BLOCK_SIZE> content = {};
 };
 // --------------------------------------------------------------------------
 struct __attribute__((packed)) Header {
     uint64_t blockSize = 0;
     uint64_t totalBlocks = 0;
     uint64_t freeBlocks = 0;
-    uint64_t freeListHeader = 0;
+    // set on close; otherwise the header is rebuilt on the next open
+    uint64_t clean = 0;
+};
+// --------------------------------------------------------------------------
+enum class IOMode {
+    // one blocking system call per request
+    Synchronous,
+    // batched requests are submitted together
+    IoUring
+};
+// --------------------------------------------------------------------------
+struct IOConfig {
+    IOMode mode = IOMode::Synchronous;
+    // bypass the page cache for the frames (O_DIRECT)
+    bool direct = false;
+    // allocations and deletions after which the header and the allocation
+    // bitmap are written back (0: only at checkpoints and on close)
+    size_t metadataBatch = 64;
 };
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
 class DiskManager {
+    public:
+    // frames are stored in slots of whole sectors
+    static constexpr size_t SLOT_SIZE =
+        (BLOCK_SIZE + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+
     private:
+    // frames
     int fd;
+    // header and allocation bitmap (always buffered, since they are tiny)
+    int metaFd;
+    bool direct;
+    size_t metadataBatch;
     Header header;
+    // allocation state, cached in memory; a set bit marks a used frame
+    std::vector<uint64_t> bitmap;
+    // free frames (the lowest ids are reused first after a restart)
+    std::vector<uint64_t> freeFrames;
+    // words of the bitmap which differ from the file
+    std::vector<bool> dirtyWords;
+    size_t pendingChanges = 0;
     mutable std::shared_mutex mutex;
+    // only used in io_uring mode; one ring per thread, so that the threads
+    // submit and reap their requests independently (the rings of finished
+    // threads are kept until the file is closed)
+    bool uring;
+    std::shared_mutex ringMutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<IoUring>> rings;
 
     public:
-    explicit DiskManager(const std::string&);
+    // the metadata is stored next to the file (with the suffix ".meta")
+    explicit DiskManager(const std::string&, IOConfig ioConfig = {});
     ~DiskManager();
 
     private:
-    void flushHeader();
-    bool isUsed(uint64_t);
+    // requests for the metadata; the buffers have to live until submission
+    IORequest headerRequest(bool);
+    void loadBitmap();
+    // rebuilds the header after the file was not closed properly
+    void recover();
+    void rebuildFreeList();
+    // flips the bit of the frame in memory
     void setUsed(uint64_t, bool);
-    void setNext(uint64_t, uint64_t);
-    Frame<BLOCK_SIZE> retrievePageHelper(uint64_t);
+    bool isUsed(uint64_t) const;
+    // writes the changed words of the bitmap and the header in one batch;
+    // the mutex has to be held
+    void flushMetadata();
+    // the ring of the calling thread (created on its first request)
+    IoUring& threadRing();
+    // executes the requests (in one batch in io_uring mode) and waits for
+    // them; throws the message if one of them fails
+    void submit(std::span<IORequest>, const char*);
+    // reads or writes the frames in one batch
+    void transferFrames(const std::vector<std::pair<uint64_t, Frame<BLOCK_SIZE>*>>&, bool, const char*);
 
     public:
     size_t entryAmount() const;
+    // whether batches of requests are submitted together (otherwise one
+    // request is executed after another)
+    bool batched() const;
+    // writes back the header and the allocation bitmap
+    void checkpoint();
     std::pair<uint64_t, Frame<BLOCK_SIZE>> createPage();
     void deletePage(uint64_t);
     Frame<BLOCK_SIZE> retrievePage(uint64_t);
+    // reads the page into the given frame (e.g. one of the buffer)
+    void readPage(uint64_t, Frame<BLOCK_SIZE>&);
+    // reads all pages in one batch
+    void readPages(const std::vector<std::pair<uint64_t, Frame<BLOCK_SIZE>*>>&);
     void writePage(uint64_t, const Frame<BLOCK_SIZE>&);
+    // writes all pages in one batch
+    void writePages(const std::vector<std::pair<uint64_t, const Frame<BLOCK_SIZE>*>>&);
 };
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
-DiskManager<BLOCK_SIZE>::DiskManager(const std::string& path) {
-    if (std::filesystem::exists(path) && std::filesystem::is_regular_file(path)) {
-        // open file
-        fd = open(path.c_str(), O_RDWR, S_IRWXU);
+DiskManager<BLOCK_SIZE>::DiskManager(const std::string& path, IOConfig ioConfig)
+    : direct(ioConfig.direct), metadataBatch(ioConfig.metadataBatch), uring(ioConfig.mode == IOMode::IoUring) {
+    const std::string metaPath = path + ".meta";
+    const bool exists = std::filesystem::exists(path) && std::filesystem::is_regular_file(path);
+    const int directFlag = direct ? O_DIRECT : 0;
+    fd = open(path.c_str(), exists ? O_RDWR | directFlag : O_RDWR | O_CREAT | directFlag, S_IRWXU);
+    // a stale metadata file of a removed one is replaced
+    metaFd = open(metaPath.c_str(), exists ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, S_IRWXU);
+    if (fd < 0 || metaFd < 0) {
+        throw std::runtime_error("couldn't open file");
+    }
+    if (uring) {
+        // fails early if io_uring isn't available
+        threadRing();
+    }
+    if (exists) {
         // read header
-        if (pread(fd, &header, sizeof(Header), 0) != sizeof(Header)) {
-            throw std::runtime_error("invalid file");
-        }
+        IORequest request = headerRequest(false);
+        submit({&request, 1}, "invalid file");
         if (header.blockSize != BLOCK_SIZE) {
             throw std::runtime_error("different block sizes");
         }
+        loadBitmap();
+        if (!header.clean) {
+            recover();
+        }
+        rebuildFreeList();
     } else {
-        // create file
-        fd = open(path.c_str(), O_RDWR | O_CREAT, S_IRWXU);
         // create header
         header = {
             BLOCK_SIZE,
             0, // allocate 0 blocks
             0, // no free blocks
             0};
-        Frame<BLOCK_SIZE> frame;
-        // write header
-        flushHeader();
     }
+    // until the file is closed, the header on disk is marked as not clean
+    header.clean = 0;
+    flushMetadata();
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
 DiskManager<BLOCK_SIZE>::~DiskManager() {
-    flushHeader();
+    flushMetadata();
+    // the flag is only written once everything else is on disk
+    header.clean = 1;
+    IORequest request = headerRequest(true);
+    submit({&request, 1}, "couldn't write header");
+    rings.clear();
     close(fd);
+    close(metaFd);
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+IORequest DiskManager<BLOCK_SIZE>::headerRequest(bool write) {
+    return {metaFd, write, &header, sizeof(Header), 0};
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
-void DiskManager<BLOCK_SIZE>::flushHeader() {
-    if (pwrite(fd, &header, sizeof(Header), 0) != sizeof(Header)) {
-        throw std::runtime_error("couldn't write header");
+void DiskManager<BLOCK_SIZE>::loadBitmap() {
+    bitmap.assign((header.totalBlocks + 63) / 64, 0);
+    dirtyWords.assign(bitmap.size(), false);
+    if (!bitmap.empty()) {
+        IORequest request = {metaFd, false, bitmap.data(), bitmap.size() * sizeof(uint64_t), sizeof(Header)};
+        submit({&request, 1}, "invalid file");
     }
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
-bool DiskManager<BLOCK_SIZE>::isUsed(uint64_t id) {
-    char buff;
-    if (pread(fd, &buff, sizeof(Frame<BLOCK_SIZE>::used),
-              sizeof(Header) + id * sizeof(Frame<BLOCK_SIZE>) +
-                  offsetof(Frame<BLOCK_SIZE>, used)) != sizeof(Frame<BLOCK_SIZE>::used)) {
-        throw std::runtime_error("couldn't read flag");
+void DiskManager<BLOCK_SIZE>::recover() {
+    // the file is extended on allocation, so it contains every frame
+    // allocated since the last write-back; since they may be referenced,
+    // they are kept (at worst, they leak)
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        throw std::runtime_error("invalid file");
+    }
+    const uint64_t fileBlocks = status.st_size / SLOT_SIZE;
+    const uint64_t persistedBlocks = header.totalBlocks;
+    header.totalBlocks = std::max(persistedBlocks, fileBlocks);
+    for (uint64_t id = persistedBlocks; id < header.totalBlocks; id++) {
+        setUsed(id, true);
     }
-    return buff;
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::rebuildFreeList() {
+    // pushed in descending order, so that the lowest ids are reused first
+    freeFrames.clear();
+    for (uint64_t id = header.totalBlocks; id > 0; id--) {
+        if (!isUsed(id - 1)) {
+            freeFrames.push_back(id - 1);
+        }
+    }
+    header.freeBlocks = freeFrames.size();
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
 void DiskManager<BLOCK_SIZE>::setUsed(uint64_t id, bool used) {
-    if (pwrite(fd, &used, sizeof(Frame<BLOCK_SIZE>::used),
-               sizeof(Header) + id * sizeof(Frame<BLOCK_SIZE>) +
-                   offsetof(Frame<BLOCK_SIZE>, used)) != sizeof(Frame<BLOCK_SIZE>::used)) {
-        throw std::runtime_error("couldn't write flag");
+    const uint64_t word = id / 64;
+    if (word >= bitmap.size()) {
+        bitmap.resize(word + 1, 0);
+        dirtyWords.resize(word + 1, false);
+    }
+    const uint64_t bit = uint64_t(1) << (id % 64);
+    bitmap[word] = used ? bitmap[word] | bit : bitmap[word] & ~bit;
+    dirtyWords[word] = true;
+    if (++pendingChanges == metadataBatch) {
+        flushMetadata();
     }
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
-void DiskManager<BLOCK_SIZE>::setNext(uint64_t id, uint64_t next) {
-    if (pwrite(fd, &next, sizeof(Frame<BLOCK_SIZE>::nextFreeFrame),
-               sizeof(Header) + id * sizeof(Frame<BLOCK_SIZE>) +
-                   offsetof(Frame<BLOCK_SIZE>, nextFreeFrame)) != sizeof(Frame<BLOCK_SIZE>::nextFreeFrame)) {
-        throw std::runtime_error("couldn't write next");
+bool DiskManager<BLOCK_SIZE>::isUsed(uint64_t id) const {
+    return id < header.totalBlocks && (bitmap[id / 64] & (uint64_t(1) << (id % 64)));
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::flushMetadata() {
+    std::vector<IORequest> requests = {headerRequest(true)};
+    // consecutive changed words are written at once
+    for (size_t begin = 0; begin < dirtyWords.size(); begin++) {
+        if (!dirtyWords[begin]) {
+            continue;
+        }
+        size_t end = begin;
+        while (end < dirtyWords.size() && dirtyWords[end]) {
+            dirtyWords[end++] = false;
+        }
+        requests.push_back({metaFd, true, &bitmap[begin], (end - begin) * sizeof(uint64_t),
+                            sizeof(Header) + begin * sizeof(uint64_t)});
+        begin = end;
     }
+    pendingChanges = 0;
+    submit(requests, "couldn't write metadata");
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
-Frame<BLOCK_SIZE> DiskManager<BLOCK_SIZE>::retrievePageHelper(uint64_t id) {
-    Frame<BLOCK_SIZE> frame;
-    if (pread(fd, &frame, sizeof(Frame<BLOCK_SIZE>),
-              sizeof(Header) + id * sizeof(Frame<BLOCK_SIZE>)) != sizeof(Frame<BLOCK_SIZE>)) {
-        throw std::runtime_error("couldn't get page");
+IoUring& DiskManager<BLOCK_SIZE>::threadRing() {
+    const std::thread::id thread = std::this_thread::get_id();
+    {
+        std::shared_lock lock(ringMutex);
+        auto it = rings.find(thread);
+        if (it != rings.end()) {
+            return *it->second;
+        }
+    }
+    std::unique_lock lock(ringMutex);
+    std::unique_ptr<IoUring>& ring = rings[thread];
+    if (!ring) {
+        ring = std::make_unique<IoUring>();
+    }
+    return *ring;
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::submit(std::span<IORequest> requests, const char* error) {
+    if (uring) {
+        IoUring& ring = threadRing();
+        ring.submit(requests);
+        ring.wait();
+    } else {
+        for (IORequest& request : requests) {
+            request.result = request.write ? pwrite(request.fd, request.data, request.length, request.offset)
+                                           : pread(request.fd, request.data, request.length, request.offset);
+        }
+    }
+    for (const IORequest& request : requests) {
+        if (request.result != static_cast<ssize_t>(request.length)) {
+            throw std::runtime_error(error);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::transferFrames(const std::vector<std::pair<uint64_t, Frame<BLOCK_SIZE>*>>& frames,
+                                             bool write, const char* error) {
+    // direct I/O needs whole sectors; unaligned frames are copied
+    const bool bounce = direct && !Frame<BLOCK_SIZE>::ALIGNED;
+    std::unique_ptr<char[]> buffer;
+    if (bounce) {
+        buffer.reset(new (std::align_val_t(DIRECT_IO_ALIGNMENT)) char[frames.size() * SLOT_SIZE]());
+    }
+    std::vector<IORequest> requests;
+    requests.reserve(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        const auto& [id, frame] = frames[i];
+        void* data = frame->content.data();
+        size_t length = direct ? SLOT_SIZE : BLOCK_SIZE;
+        if (bounce) {
+            data = buffer.get() + i * SLOT_SIZE;
+            if (write) {
+                std::memcpy(data, frame->content.data(), BLOCK_SIZE);
+            }
+        }
+        requests.push_back({fd, write, data, length, id * SLOT_SIZE});
+    }
+    submit(requests, error);
+    if (bounce && !write) {
+        for (size_t i = 0; i < frames.size(); i++) {
+            std::memcpy(frames[i].second->content.data(), buffer.get() + i * SLOT_SIZE, BLOCK_SIZE);
+        }
     }
-    return frame;
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
@@ -145,61 +349,89 @@ size_t DiskManager<BLOCK_SIZE>::entryAmount() const {
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
+bool DiskManager<BLOCK_SIZE>::batched() const {
+    return uring;
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::checkpoint() {
+    std::unique_lock lock(mutex);
+    flushMetadata();
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
 std::pair<uint64_t, Frame<BLOCK_SIZE>> DiskManager<BLOCK_SIZE>::createPage() {
     std::unique_lock lock(mutex);
+    uint64_t id;
+    const bool reused = !freeFrames.empty();
     // check if enough pages are free
-    if (header.freeBlocks > 0) {
-        // the header points to a free frame; use that
-        uint64_t freePage = header.freeListHeader;
-        // mark the frame as used
-        setUsed(freePage, true);
-        Frame<BLOCK_SIZE> frame = retrievePageHelper(freePage);
-        // copy the id the free frame points to
-        header.freeListHeader = frame.nextFreeFrame;
+    if (reused) {
+        id = freeFrames.back();
+        freeFrames.pop_back();
         header.freeBlocks--;
-        flushHeader();
-        return std::make_pair(freePage, std::move(frame));
     } else {
         // create a new frame with an id
-        uint64_t newID = header.totalBlocks;
-        Frame<BLOCK_SIZE> newFrame;
-        newFrame.used = true;
-        // write it to the end of the file
-        if (pwrite(fd, &newFrame, sizeof(Frame<BLOCK_SIZE>),
-                   sizeof(Header) + header.totalBlocks * sizeof(Frame<BLOCK_SIZE>)) != sizeof(Frame<BLOCK_SIZE>)) {
+        id = header.totalBlocks;
+        // extend the file by an empty slot
+        if (ftruncate(fd, (id + 1) * SLOT_SIZE) != 0) {
             throw std::runtime_error("couldn't write frame");
         }
         header.totalBlocks++;
-        flushHeader();
-        return std::make_pair(newID, std::move(newFrame));
     }
+    setUsed(id, true);
+    // a reused frame is free on disk, so it would be handed out twice after
+    // a crash; frames beyond the header are recovered from the file size
+    const uint64_t word = id / 64;
+    if (reused && dirtyWords[word]) {
+        dirtyWords[word] = false;
+        IORequest request = {metaFd, true, &bitmap[word], sizeof(uint64_t), sizeof(Header) + word * sizeof(uint64_t)};
+        submit({&request, 1}, "couldn't write metadata");
+    }
+    return std::make_pair(id, Frame<BLOCK_SIZE>{});
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
 void DiskManager<BLOCK_SIZE>::deletePage(uint64_t id) {
+    std::unique_lock lock(mutex);
     if (!isUsed(id)) {
         return;
     }
-    setUsed(id, false);
-    std::unique_lock lock(mutex);
-    setNext(id, header.freeListHeader);
-    header.freeListHeader = id;
+    freeFrames.push_back(id);
     header.freeBlocks++;
-    flushHeader();
+    setUsed(id, false);
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
 Frame<BLOCK_SIZE> DiskManager<BLOCK_SIZE>::retrievePage(uint64_t id) {
-    return retrievePageHelper(id);
+    Frame<BLOCK_SIZE> frame;
+    readPage(id, frame);
+    return frame;
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::readPage(uint64_t id, Frame<BLOCK_SIZE>& frame) {
+    transferFrames({{id, &frame}}, false, "couldn't get page");
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::readPages(const std::vector<std::pair<uint64_t, Frame<BLOCK_SIZE>*>>& frames) {
+    transferFrames(frames, false, "couldn't get page");
 }
 // --------------------------------------------------------------------------
 template <size_t BLOCK_SIZE>
 void DiskManager<BLOCK_SIZE>::writePage(uint64_t id, const Frame<BLOCK_SIZE>& frame) {
-    if (pwrite(fd, &frame, sizeof(Frame<BLOCK_SIZE>),
-               sizeof(Header) + id * sizeof(Frame<BLOCK_SIZE>)) != sizeof(Frame<BLOCK_SIZE>)) {
-        throw std::runtime_error("couldn't write frame");
+    // frames are only read into non-const ones
+    transferFrames({{id, const_cast<Frame<BLOCK_SIZE>*>(&frame)}}, true, "couldn't write frame");
+}
+// --------------------------------------------------------------------------
+template <size_t BLOCK_SIZE>
+void DiskManager<BLOCK_SIZE>::writePages(const std::vector<std::pair<uint64_t, const Frame<BLOCK_SIZE>*>>& frames) {
+    std::vector<std::pair<uint64_t, Frame<BLOCK_SIZE>*>> transfers;
+    transfers.reserve(frames.size());
+    for (const auto& [id, frame] : frames) {
+        transfers.emplace_back(id, const_cast<Frame<BLOCK_SIZE>*>(frame));
     }
-    return;
+    transferFrames(transfers, true, "couldn't write frame");
 }
 // --------------------------------------------------------------------------
 } // namespace disk
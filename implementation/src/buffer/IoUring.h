@@ -0,0 +1,225 @@
+#ifndef BTREE_IOURING_H
+#define BTREE_IOURING_H
+// --------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// the kernel headers define BLOCK_SIZE, which is a template parameter here
+#pragma push_macro("BLOCK_SIZE")
+#include <linux/io_uring.h>
+#undef BLOCK_SIZE
+#pragma pop_macro("BLOCK_SIZE")
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+// --------------------------------------------------------------------------
+namespace disk {
+// --------------------------------------------------------------------------
+struct IORequest {
+    int fd;
+    bool write;
+    void* data;
+    size_t length;
+    uint64_t offset;
+    // transferred bytes or the negated error number
+    ssize_t result = 0;
+};
+// --------------------------------------------------------------------------
+// minimal io_uring wrapper (raw system calls, no liburing); a ring is only
+// used by one thread at a time (the disk manager keeps one per thread), so
+// neither submissions nor completions are synchronized
+class IoUring {
+    private:
+    int ringFd;
+    unsigned sqEntries;
+    // mapped rings
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+    // submitted to the kernel, but not reaped yet
+    size_t inFlight = 0;
+
+    public:
+    explicit IoUring(unsigned entries = 256);
+    // waits for the requests in flight, since the kernel still uses them
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    // submits the requests as one batch without waiting for them; they (and
+    // their buffers) have to live until they are reaped; if the submission
+    // fails, the requests which already reached the kernel are waited for
+    // before the exception is thrown
+    void submit(std::span<IORequest>);
+    // reaps the available completions (sets the results of their requests);
+    // returns their amount
+    size_t poll();
+    // reaps completions until at most the given amount of requests is in flight
+    void wait(size_t remaining = 0);
+    size_t pending() const;
+
+    private:
+    int enter(unsigned, unsigned, unsigned);
+};
+// --------------------------------------------------------------------------
+inline IoUring::IoUring(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ringFd < 0) {
+        throw std::runtime_error("io_uring is not available");
+    }
+    // the kernel must not drop completions if more requests are in flight
+    // than the completion queue holds
+    if (!(params.features & IORING_FEAT_NODROP)) {
+        close(ringFd);
+        throw std::runtime_error("io_uring is too old");
+    }
+    sqEntries = params.sq_entries;
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                  IORING_OFF_SQ_RING);
+    cqRing = singleMap ? sqRing
+                       : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                              IORING_OFF_CQ_RING);
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                           ringFd, IORING_OFF_SQES));
+    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+        close(ringFd);
+        throw std::runtime_error("couldn't map io_uring");
+    }
+    auto* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    auto* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+// --------------------------------------------------------------------------
+inline IoUring::~IoUring() {
+    wait();
+    munmap(sqes, sqesSize);
+    if (cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    munmap(sqRing, sqRingSize);
+    close(ringFd);
+}
+// --------------------------------------------------------------------------
+inline int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    int result;
+    do {
+        result = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+// --------------------------------------------------------------------------
+inline size_t IoUring::poll() {
+    std::atomic_ref<unsigned> tail(*cqTail);
+    std::atomic_ref<unsigned> head(*cqHead);
+    unsigned current = head.load(std::memory_order_relaxed);
+    size_t reaped = 0;
+    while (current != tail.load(std::memory_order_acquire)) {
+        const io_uring_cqe& cqe = cqes[current & cqMask];
+        reinterpret_cast<IORequest*>(cqe.user_data)->result = cqe.res;
+        current++;
+        reaped++;
+    }
+    head.store(current, std::memory_order_release);
+    inFlight -= reaped;
+    return reaped;
+}
+// --------------------------------------------------------------------------
+inline void IoUring::wait(size_t remaining) {
+    while (inFlight > remaining) {
+        if (poll() > 0) {
+            continue;
+        }
+        // the completions arrive in any case; if the kernel refuses to wait,
+        // poll instead
+        if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+// --------------------------------------------------------------------------
+inline size_t IoUring::pending() const {
+    return inFlight;
+}
+// --------------------------------------------------------------------------
+inline void IoUring::submit(std::span<IORequest> requests) {
+    std::atomic_ref<unsigned> tail(*sqTail);
+    std::atomic_ref<unsigned> head(*sqHead);
+    size_t queued = 0;
+    while (queued < requests.size()) {
+        unsigned current = tail.load(std::memory_order_relaxed);
+        const unsigned space = sqEntries - (current - head.load(std::memory_order_acquire));
+        const size_t amount = std::min<size_t>(space, requests.size() - queued);
+        for (size_t i = queued; i < queued + amount; i++, current++) {
+            const unsigned index = current & sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = requests[i].write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe.fd = requests[i].fd;
+            sqe.addr = reinterpret_cast<uint64_t>(requests[i].data);
+            sqe.len = static_cast<uint32_t>(requests[i].length);
+            sqe.off = requests[i].offset;
+            sqe.user_data = reinterpret_cast<uint64_t>(&requests[i]);
+            sqArray[index] = index;
+        }
+        tail.store(current, std::memory_order_release);
+        queued += amount;
+        // the kernel consumes the whole queue (there is no polling thread)
+        while (head.load(std::memory_order_acquire) != current) {
+            const int consumed = enter(current - head.load(std::memory_order_acquire), 0, 0);
+            if (consumed >= 0) {
+                inFlight += consumed;
+                continue;
+            }
+            if (errno == EAGAIN || errno == EBUSY) {
+                // too many completions are pending; make room
+                if (poll() == 0 && inFlight > 0) {
+                    wait(inFlight - 1);
+                }
+                continue;
+            }
+            // the entries the kernel didn't consume are withdrawn; the
+            // consumed ones still refer to the requests
+            tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+            wait();
+            throw std::runtime_error("couldn't submit to io_uring");
+        }
+    }
+}
+// --------------------------------------------------------------------------
+} // namespace disk
+// --------------------------------------------------------------------------
+#endif //BTREE_IOURING_H
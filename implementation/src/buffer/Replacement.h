@@ -0,0 +1,783 @@
+#ifndef BTREE_REPLACEMENT_H
+#define BTREE_REPLACEMENT_H
+// --------------------------------------------------------------------------
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+// --------------------------------------------------------------------------
+namespace buffer {
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+struct Page;
+template <size_t PAGE_SIZE>
+class PageArena;
+// --------------------------------------------------------------------------
+enum class Replacement {
+    // second chance with the reference bits of the pages
+    Clock,
+    // new pages are evicted in fifo order; only pages which are requested
+    // again soon after their eviction are kept by the clock (full 2q)
+    TwoQ,
+    // evicts the page whose second-last access is the oldest (lru-2) among
+    // a random sample
+    LRUK,
+    // evicts the least frequently used page among a random sample; the
+    // frequencies decay over time
+    LFU,
+    // randomly chosen pages are unswizzled and cool down in a fifo; they are
+    // evicted unless they are accessed before they leave it (leanstore)
+    Cooling
+};
+// --------------------------------------------------------------------------
+// the state of recently evicted pages, the oldest are dropped first
+template <class VALUE>
+class Ghosts {
+    private:
+    // the entries are tagged by their insertion, so that a page which has been
+    // evicted again isn't dropped by its older entry
+    std::unordered_map<uint64_t, std::pair<VALUE, uint64_t>> entries;
+    std::deque<std::pair<uint64_t, uint64_t>> order;
+    uint64_t insertions = 0;
+
+    public:
+    // keeps at most the given amount of pages
+    void insert(uint64_t, VALUE, size_t);
+    // removes the state of the page
+    std::optional<VALUE> take(uint64_t);
+};
+// --------------------------------------------------------------------------
+// decides which pages are evicted; apart from accessed, the functions run
+// while the mutex of the buffer manager is held exclusively (upcoming only
+// shared)
+template <size_t PAGE_SIZE>
+class ReplacementPolicy {
+    protected:
+    const PageArena<PAGE_SIZE>& buffer;
+
+    public:
+    explicit ReplacementPolicy(const PageArena<PAGE_SIZE>&);
+    virtual ~ReplacementPolicy() = default;
+    ReplacementPolicy(const ReplacementPolicy&) = delete;
+    ReplacementPolicy& operator=(const ReplacementPolicy&) = delete;
+    // the page has been pinned; runs concurrently without the mutex, so only
+    // the atomic state of the page may be changed
+    virtual void accessed(Page<PAGE_SIZE>&) = 0;
+    // the page with the id has been placed into the frame at the index (by a
+    // miss, once it is read; the frame is still claimed and holds the id of
+    // the evicted page then)
+    virtual void loaded(size_t, uint64_t);
+    // the claimed page of the frame at the index is evicted (a modified page
+    // once it is written back)
+    virtual void evicted(size_t, const Page<PAGE_SIZE>&);
+    // starts the search for a victim among the frames [0, frameAmount) (all
+    // of them contain pages)
+    virtual void begin(size_t) = 0;
+    // the next frame to try; returns false if there is none left (the page
+    // might still be unusable, e.g. if its parent is latched). a search has to
+    // end after a bounded number of frames, as it runs under the mutex
+    virtual bool next(size_t&) = 0;
+    // adds up to the given amount of frames among the first ones whose pages
+    // are probably evicted soon (the background writer flushes them)
+    virtual void upcoming(size_t, size_t, std::vector<size_t>&) const = 0;
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+class ClockPolicy : public ReplacementPolicy<PAGE_SIZE> {
+    protected:
+    using ReplacementPolicy<PAGE_SIZE>::buffer;
+    size_t hand = 0;
+    size_t frameAmount = 0;
+    size_t encounters = 0;
+    bool clearedReferences = false;
+
+    public:
+    using ReplacementPolicy<PAGE_SIZE>::ReplacementPolicy;
+    void accessed(Page<PAGE_SIZE>&) override;
+    void begin(size_t) override;
+    bool next(size_t&) override;
+    void upcoming(size_t, size_t, std::vector<size_t>&) const override;
+
+    protected:
+    // whether the clock considers the page at all
+    virtual bool eligible(const Page<PAGE_SIZE>&) const;
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+class TwoQPolicy : public ClockPolicy<PAGE_SIZE> {
+    private:
+    using ReplacementPolicy<PAGE_SIZE>::buffer;
+    using Clock = ClockPolicy<PAGE_SIZE>;
+    // new pages (a1in) in the order of their loading; the entries of evicted
+    // pages are dropped lazily
+    std::deque<std::pair<size_t, uint64_t>> probation;
+    std::vector<bool> inProbation;
+    size_t probationary = 0;
+    // pages evicted from probation (a1out)
+    Ghosts<bool> ghosts;
+    // search; probation is tried first if it exceeds its share of the frames,
+    // everything else is swept in the end
+    enum class Phase { Probation, Clock, Sweep };
+    std::array<Phase, 3> phases;
+    size_t phase = 0;
+    size_t position = 0;
+
+    public:
+    using ClockPolicy<PAGE_SIZE>::ClockPolicy;
+    void accessed(Page<PAGE_SIZE>&) override;
+    void loaded(size_t, uint64_t) override;
+    void evicted(size_t, const Page<PAGE_SIZE>&) override;
+    void begin(size_t) override;
+    bool next(size_t&) override;
+    void upcoming(size_t, size_t, std::vector<size_t>&) const override;
+
+    private:
+    bool eligible(const Page<PAGE_SIZE>&) const override;
+    // whether the entry still refers to a page in probation
+    bool valid(const std::pair<size_t, uint64_t>&) const;
+};
+// --------------------------------------------------------------------------
+// evicts the page with the lowest score among a few random frames; the
+// frames are swept if no sample contains an unpinned page
+template <size_t PAGE_SIZE>
+class SampledPolicy : public ReplacementPolicy<PAGE_SIZE> {
+    protected:
+    using ReplacementPolicy<PAGE_SIZE>::buffer;
+    using Score = std::pair<uint64_t, uint64_t>;
+    static constexpr size_t SAMPLE_SIZE = 16;
+    static constexpr size_t SAMPLES = 4;
+    // logical time; advanced by every load
+    std::atomic<uint64_t> now = 0;
+    // the state of evicted pages, restored when they are loaded again (the
+    // information is retained for as many pages as there are frames)
+    Ghosts<std::array<uint64_t, 2>> ghosts;
+    std::optional<std::array<uint64_t, 2>> restored;
+
+    private:
+    std::default_random_engine engine;
+    size_t frameAmount = 0;
+    size_t samples = 0;
+    size_t sweepStart = 0;
+    size_t swept = 0;
+    // start of the frames which upcoming examines next
+    mutable std::atomic<size_t> cursor = 0;
+
+    public:
+    using ReplacementPolicy<PAGE_SIZE>::ReplacementPolicy;
+    void loaded(size_t, uint64_t) override;
+    void evicted(size_t, const Page<PAGE_SIZE>&) override;
+    void begin(size_t) override;
+    bool next(size_t&) override;
+    void upcoming(size_t, size_t, std::vector<size_t>&) const override;
+
+    protected:
+    // pages with lower scores are evicted first
+    virtual Score score(const Page<PAGE_SIZE>&) const = 0;
+};
+// --------------------------------------------------------------------------
+// the state of a page holds the times of its last two accesses
+template <size_t PAGE_SIZE>
+class LRUKPolicy : public SampledPolicy<PAGE_SIZE> {
+    private:
+    using ReplacementPolicy<PAGE_SIZE>::buffer;
+    using typename SampledPolicy<PAGE_SIZE>::Score;
+
+    public:
+    using SampledPolicy<PAGE_SIZE>::SampledPolicy;
+    void accessed(Page<PAGE_SIZE>&) override;
+    void loaded(size_t, uint64_t) override;
+
+    private:
+    Score score(const Page<PAGE_SIZE>&) const override;
+};
+// --------------------------------------------------------------------------
+// the state of a page holds its access count and the time of its last access
+template <size_t PAGE_SIZE>
+class LFUPolicy : public SampledPolicy<PAGE_SIZE> {
+    private:
+    using ReplacementPolicy<PAGE_SIZE>::buffer;
+    using typename SampledPolicy<PAGE_SIZE>::Score;
+    static constexpr uint64_t MAX_COUNT = 255;
+    // the counts are halved whenever this many times the frames were loaded
+    // since the last access
+    static constexpr uint64_t DECAY = 8;
+    std::atomic<uint64_t> period;
+
+    public:
+    LFUPolicy(const PageArena<PAGE_SIZE>&, size_t);
+    void accessed(Page<PAGE_SIZE>&) override;
+    void loaded(size_t, uint64_t) override;
+    void begin(size_t) override;
+
+    private:
+    Score score(const Page<PAGE_SIZE>&) const override;
+    uint64_t decayedCount(const Page<PAGE_SIZE>&, uint64_t) const;
+};
+// --------------------------------------------------------------------------
+// the state of a page holds the tag of its entry in the fifo while it cools
+template <size_t PAGE_SIZE>
+class CoolingPolicy : public ReplacementPolicy<PAGE_SIZE> {
+    public:
+    // removes the pointer to the page from its parent; fails if the parent is
+    // latched
+    using UnswizzleFunc = std::function<bool(Page<PAGE_SIZE>&)>;
+
+    private:
+    using ReplacementPolicy<PAGE_SIZE>::buffer;
+    // share of the frames which cool (in percent)
+    static constexpr size_t COOLING_PERCENTAGE = 10;
+    // random frames which are tried per search
+    static constexpr size_t COOLING_ATTEMPTS = 16;
+    struct Entry {
+        size_t index;
+        uint64_t id;
+        uint64_t tag;
+    };
+    UnswizzleFunc unswizzle;
+    // the cooling pages in the order of their cooling; the entries of pages
+    // which have been accessed (or evicted) in the meantime are dropped lazily
+    std::deque<Entry> fifo;
+    std::atomic<size_t> cooling = 0;
+    uint64_t tags = 0;
+    std::default_random_engine engine;
+    size_t frameAmount = 0;
+    // the pages cooled by the current search are only evicted if no other
+    // page can be
+    size_t cooledBefore = 0;
+    size_t position = 0;
+    size_t swept = 0;
+    bool cooledAgain = false;
+
+    public:
+    CoolingPolicy(const PageArena<PAGE_SIZE>&, UnswizzleFunc);
+    void accessed(Page<PAGE_SIZE>&) override;
+    void loaded(size_t, uint64_t) override;
+    void evicted(size_t, const Page<PAGE_SIZE>&) override;
+    void begin(size_t) override;
+    bool next(size_t&) override;
+    void upcoming(size_t, size_t, std::vector<size_t>&) const override;
+
+    private:
+    // moves random unpinned pages into the fifo until it holds its share of
+    // the frames
+    void cool();
+    // whether the page of the entry still cools (among the given frames)
+    bool valid(const Entry&, size_t) const;
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+std::unique_ptr<ReplacementPolicy<PAGE_SIZE>> makePolicy(Replacement replacement,
+                                                          const PageArena<PAGE_SIZE>& buffer,
+                                                          size_t frameAmount,
+                                                          typename CoolingPolicy<PAGE_SIZE>::UnswizzleFunc unswizzle) {
+    switch (replacement) {
+        case Replacement::TwoQ:
+            return std::make_unique<TwoQPolicy<PAGE_SIZE>>(buffer);
+        case Replacement::LRUK:
+            return std::make_unique<LRUKPolicy<PAGE_SIZE>>(buffer);
+        case Replacement::LFU:
+            return std::make_unique<LFUPolicy<PAGE_SIZE>>(buffer, frameAmount);
+        case Replacement::Cooling:
+            return std::make_unique<CoolingPolicy<PAGE_SIZE>>(buffer, std::move(unswizzle));
+        default:
+            return std::make_unique<ClockPolicy<PAGE_SIZE>>(buffer);
+    }
+}
+// --------------------------------------------------------------------------
+template <class VALUE>
+void Ghosts<VALUE>::insert(uint64_t id, VALUE value, size_t limit) {
+    entries[id] = {value, insertions};
+    order.emplace_back(id, insertions++);
+    while (order.size() > limit) {
+        const auto [oldest, insertion] = order.front();
+        order.pop_front();
+        const auto it = entries.find(oldest);
+        if (it != entries.end() && it->second.second == insertion) {
+            entries.erase(it);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+template <class VALUE>
+std::optional<VALUE> Ghosts<VALUE>::take(uint64_t id) {
+    const auto it = entries.find(id);
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    VALUE value = it->second.first;
+    // (its entry in the order is skipped later)
+    entries.erase(it);
+    return value;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+ReplacementPolicy<PAGE_SIZE>::ReplacementPolicy(const PageArena<PAGE_SIZE>& buffer) : buffer(buffer) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void ReplacementPolicy<PAGE_SIZE>::loaded(size_t, uint64_t) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void ReplacementPolicy<PAGE_SIZE>::evicted(size_t, const Page<PAGE_SIZE>&) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void ClockPolicy<PAGE_SIZE>::accessed(Page<PAGE_SIZE>& page) {
+    page.referenced = true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void ClockPolicy<PAGE_SIZE>::begin(size_t frames) {
+    frameAmount = frames;
+    if (hand >= frameAmount) {
+        hand = 0;
+    }
+    encounters = 0;
+    clearedReferences = false;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool ClockPolicy<PAGE_SIZE>::next(size_t& index) {
+    // one round, and a second one only if the first cleared reference bits
+    // (concurrent accesses might set them again, so there is no third)
+    while (encounters < frameAmount || (clearedReferences && encounters < 2 * frameAmount)) {
+        const size_t current = hand;
+        hand = (hand + 1) % frameAmount;
+        encounters++;
+        auto& page = *buffer[current];
+        // (parents of swizzled pages stay in memory)
+        if (page.pinned != 0 || page.swizzledChildren != 0 || !eligible(page)) {
+            continue;
+        }
+        if (page.deleted || !page.referenced) {
+            index = current;
+            return true;
+        }
+        // second chance
+        page.referenced = false;
+        clearedReferences = true;
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void ClockPolicy<PAGE_SIZE>::upcoming(size_t frames, size_t amount, std::vector<size_t>& result) const {
+    // the hand only moves while the mutex is held exclusively
+    for (size_t i = 0; i < amount && i < frames; i++) {
+        const size_t index = (hand + i) % frames;
+        const auto& page = *buffer[index];
+        // referenced pages get a second chance before they are evicted
+        if (eligible(page) && !page.referenced) {
+            result.push_back(index);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool ClockPolicy<PAGE_SIZE>::eligible(const Page<PAGE_SIZE>&) const {
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void TwoQPolicy<PAGE_SIZE>::accessed(Page<PAGE_SIZE>& page) {
+    // accesses to pages in probation are ignored
+    if (page.policyState[0].load(std::memory_order_relaxed)) {
+        page.referenced = true;
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void TwoQPolicy<PAGE_SIZE>::loaded(size_t index, uint64_t id) {
+    if (index >= inProbation.size()) {
+        inProbation.resize(index + 1);
+    }
+    // the previous page might have been removed without an eviction (x-merge)
+    if (inProbation[index]) {
+        inProbation[index] = false;
+        probationary--;
+    }
+    const bool hot = ghosts.take(id).has_value();
+    buffer[index]->policyState[0] = hot;
+    if (!hot) {
+        inProbation[index] = true;
+        probationary++;
+        probation.emplace_back(index, id);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void TwoQPolicy<PAGE_SIZE>::evicted(size_t index, const Page<PAGE_SIZE>& page) {
+    if (index >= inProbation.size() || !inProbation[index]) {
+        return;
+    }
+    inProbation[index] = false;
+    probationary--;
+    if (page.deleted || page.id == Page<PAGE_SIZE>::INVALID_ID) {
+        return;
+    }
+    ghosts.insert(page.id, true, Clock::frameAmount / 2 + 1);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void TwoQPolicy<PAGE_SIZE>::begin(size_t frames) {
+    Clock::begin(frames);
+    while (!probation.empty() && !valid(probation.front())) {
+        probation.pop_front();
+    }
+    if (probation.size() > 2 * frames) {
+        std::erase_if(probation, [this](const auto& entry) { return !valid(entry); });
+    }
+    if (probationary > frames / 4) {
+        phases = {Phase::Probation, Phase::Clock, Phase::Sweep};
+    } else {
+        phases = {Phase::Clock, Phase::Probation, Phase::Sweep};
+    }
+    phase = 0;
+    position = 0;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool TwoQPolicy<PAGE_SIZE>::next(size_t& index) {
+    const size_t frames = Clock::frameAmount;
+    while (phase < phases.size()) {
+        switch (phases[phase]) {
+            case Phase::Probation:
+                while (position < probation.size()) {
+                    const auto& entry = probation[position++];
+                    if (entry.first < frames && valid(entry)) {
+                        index = entry.first;
+                        return true;
+                    }
+                }
+                break;
+            case Phase::Clock:
+                if (Clock::next(index)) {
+                    return true;
+                }
+                break;
+            case Phase::Sweep:
+                // pages which are neither in probation nor hot (failed loads)
+                while (position < frames) {
+                    const size_t current = position++;
+                    if (buffer[current]->pinned == 0) {
+                        index = current;
+                        return true;
+                    }
+                }
+                break;
+        }
+        phase++;
+        position = 0;
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void TwoQPolicy<PAGE_SIZE>::upcoming(size_t frames, size_t amount, std::vector<size_t>& result) const {
+    if (probationary <= frames / 4) {
+        Clock::upcoming(frames, amount, result);
+        return;
+    }
+    for (size_t i = 0; i < probation.size() && result.size() < amount; i++) {
+        if (probation[i].first < frames && valid(probation[i])) {
+            result.push_back(probation[i].first);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool TwoQPolicy<PAGE_SIZE>::eligible(const Page<PAGE_SIZE>& page) const {
+    return page.deleted || page.policyState[0].load(std::memory_order_relaxed);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool TwoQPolicy<PAGE_SIZE>::valid(const std::pair<size_t, uint64_t>& entry) const {
+    const auto [index, id] = entry;
+    if (index >= inProbation.size() || !inProbation[index]) {
+        return false;
+    }
+    // a loading frame still holds the id of the evicted page
+    const auto& page = *buffer[index];
+    return page.id == id || page.loading;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void SampledPolicy<PAGE_SIZE>::loaded(size_t, uint64_t id) {
+    now.store(now.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    restored = ghosts.take(id);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void SampledPolicy<PAGE_SIZE>::evicted(size_t, const Page<PAGE_SIZE>& page) {
+    if (page.deleted || page.id == Page<PAGE_SIZE>::INVALID_ID) {
+        return;
+    }
+    ghosts.insert(page.id, {page.policyState[0].load(), page.policyState[1].load()}, frameAmount);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void SampledPolicy<PAGE_SIZE>::begin(size_t frames) {
+    frameAmount = frames;
+    samples = 0;
+    swept = 0;
+    sweepStart = std::uniform_int_distribution<size_t>(0, frames - 1)(engine);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool SampledPolicy<PAGE_SIZE>::next(size_t& index) {
+    std::uniform_int_distribution<size_t> distribution(0, frameAmount - 1);
+    while (samples < SAMPLES) {
+        samples++;
+        bool found = false;
+        Score lowest;
+        for (size_t i = 0; i < std::min(SAMPLE_SIZE, frameAmount); i++) {
+            const size_t candidate = distribution(engine);
+            const auto& page = *buffer[candidate];
+            // (parents of swizzled pages stay in memory)
+            if (page.pinned != 0 || page.swizzledChildren != 0) {
+                continue;
+            }
+            const Score current = page.deleted ? Score(0, 0) : score(page);
+            if (!found || current < lowest) {
+                found = true;
+                lowest = current;
+                index = candidate;
+            }
+        }
+        if (found) {
+            return true;
+        }
+    }
+    // all samples were pinned; don't miss the few unpinned pages
+    while (swept < frameAmount) {
+        const size_t candidate = (sweepStart + swept++) % frameAmount;
+        const auto& page = *buffer[candidate];
+        if (page.pinned == 0 && page.swizzledChildren == 0) {
+            index = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void SampledPolicy<PAGE_SIZE>::upcoming(size_t frames, size_t amount, std::vector<size_t>& result) const {
+    if (frames == 0) {
+        return;
+    }
+    // the colder half of the next frames
+    const size_t start = cursor.fetch_add(amount, std::memory_order_relaxed) % frames;
+    std::vector<std::pair<Score, size_t>> window;
+    for (size_t i = 0; i < amount && i < frames; i++) {
+        const size_t index = (start + i) % frames;
+        window.emplace_back(score(*buffer[index]), index);
+    }
+    const auto middle = window.begin() + (window.size() + 1) / 2;
+    std::nth_element(window.begin(), middle, window.end());
+    for (auto it = window.begin(); it != middle; ++it) {
+        result.push_back(it->second);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void LRUKPolicy<PAGE_SIZE>::accessed(Page<PAGE_SIZE>& page) {
+    const uint64_t time = this->now.load(std::memory_order_relaxed);
+    // accesses without a load in between are correlated; only the first counts
+    if (page.policyState[0].load(std::memory_order_relaxed) != time) {
+        page.policyState[1].store(page.policyState[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        page.policyState[0].store(time, std::memory_order_relaxed);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void LRUKPolicy<PAGE_SIZE>::loaded(size_t index, uint64_t id) {
+    SampledPolicy<PAGE_SIZE>::loaded(index, id);
+    auto& page = *buffer[index];
+    // the load is an access
+    page.policyState[0] = this->now.load(std::memory_order_relaxed);
+    page.policyState[1] = this->restored ? (*this->restored)[0] : 0;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+typename LRUKPolicy<PAGE_SIZE>::Score LRUKPolicy<PAGE_SIZE>::score(const Page<PAGE_SIZE>& page) const {
+    // pages accessed only once come first (scans), then lru
+    return {page.policyState[1].load(std::memory_order_relaxed), page.policyState[0].load(std::memory_order_relaxed)};
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+LFUPolicy<PAGE_SIZE>::LFUPolicy(const PageArena<PAGE_SIZE>& buffer, size_t frameAmount)
+    : SampledPolicy<PAGE_SIZE>(buffer), period(DECAY * frameAmount) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void LFUPolicy<PAGE_SIZE>::accessed(Page<PAGE_SIZE>& page) {
+    const uint64_t time = this->now.load(std::memory_order_relaxed);
+    // concurrent accesses might get lost
+    const uint64_t count = std::min(decayedCount(page, time) + 1, MAX_COUNT);
+    page.policyState[0].store(count, std::memory_order_relaxed);
+    page.policyState[1].store(time, std::memory_order_relaxed);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void LFUPolicy<PAGE_SIZE>::loaded(size_t index, uint64_t id) {
+    SampledPolicy<PAGE_SIZE>::loaded(index, id);
+    auto& page = *buffer[index];
+    const uint64_t time = this->now.load(std::memory_order_relaxed);
+    // the load is an access
+    uint64_t count = 1;
+    if (this->restored) {
+        page.policyState[0] = (*this->restored)[0];
+        page.policyState[1] = (*this->restored)[1];
+        count = std::min(decayedCount(page, time) + 1, MAX_COUNT);
+    }
+    page.policyState[0] = count;
+    page.policyState[1] = time;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void LFUPolicy<PAGE_SIZE>::begin(size_t frames) {
+    SampledPolicy<PAGE_SIZE>::begin(frames);
+    period.store(DECAY * frames, std::memory_order_relaxed);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+typename LFUPolicy<PAGE_SIZE>::Score LFUPolicy<PAGE_SIZE>::score(const Page<PAGE_SIZE>& page) const {
+    const uint64_t time = this->now.load(std::memory_order_relaxed);
+    // ties are broken by the last access
+    return {decayedCount(page, time), page.policyState[1].load(std::memory_order_relaxed)};
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+uint64_t LFUPolicy<PAGE_SIZE>::decayedCount(const Page<PAGE_SIZE>& page, uint64_t time) const {
+    const uint64_t last = page.policyState[1].load(std::memory_order_relaxed);
+    const uint64_t halvings = (time - std::min(last, time)) / period.load(std::memory_order_relaxed);
+    return halvings >= 64 ? 0 : page.policyState[0].load(std::memory_order_relaxed) >> halvings;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+CoolingPolicy<PAGE_SIZE>::CoolingPolicy(const PageArena<PAGE_SIZE>& buffer, UnswizzleFunc unswizzle)
+    : ReplacementPolicy<PAGE_SIZE>(buffer), unswizzle(std::move(unswizzle)) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void CoolingPolicy<PAGE_SIZE>::accessed(Page<PAGE_SIZE>& page) {
+    // the page is hot again (its entry stays in the fifo)
+    if (page.policyState[0].load(std::memory_order_relaxed) != 0 && page.policyState[0].exchange(0) != 0) {
+        cooling--;
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void CoolingPolicy<PAGE_SIZE>::loaded(size_t index, uint64_t) {
+    // the previous page might have been removed without an eviction (x-merge)
+    if (buffer[index]->policyState[0].exchange(0) != 0) {
+        cooling--;
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void CoolingPolicy<PAGE_SIZE>::evicted(size_t index, const Page<PAGE_SIZE>&) {
+    if (buffer[index]->policyState[0].exchange(0) != 0) {
+        cooling--;
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void CoolingPolicy<PAGE_SIZE>::begin(size_t frames) {
+    frameAmount = frames;
+    while (!fifo.empty() && !valid(fifo.front(), frameAmount)) {
+        fifo.pop_front();
+    }
+    if (fifo.size() > 2 * frameAmount) {
+        std::erase_if(fifo, [this](const Entry& entry) { return !valid(entry, frameAmount); });
+    }
+    cooledBefore = fifo.size();
+    position = 0;
+    swept = 0;
+    cooledAgain = false;
+    cool();
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool CoolingPolicy<PAGE_SIZE>::next(size_t& index) {
+    while (true) {
+        // the pages which cool the longest first
+        while (position < (cooledAgain ? fifo.size() : cooledBefore)) {
+            const Entry& entry = fifo[position++];
+            if (valid(entry, frameAmount)) {
+                index = entry.index;
+                return true;
+            }
+        }
+        if (cooledAgain) {
+            break;
+        }
+        // all cooling pages are in use
+        cooledAgain = true;
+        cool();
+    }
+    // don't miss the few unpinned pages
+    while (swept < frameAmount) {
+        const size_t current = swept++;
+        if (buffer[current]->pinned == 0) {
+            index = current;
+            return true;
+        }
+    }
+    return false;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void CoolingPolicy<PAGE_SIZE>::upcoming(size_t frames, size_t amount, std::vector<size_t>& result) const {
+    for (size_t i = 0; i < fifo.size() && result.size() < amount; i++) {
+        if (valid(fifo[i], frames)) {
+            result.push_back(fifo[i].index);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void CoolingPolicy<PAGE_SIZE>::cool() {
+    const size_t target = frameAmount * COOLING_PERCENTAGE / 100 + 1;
+    std::uniform_int_distribution<size_t> distribution(0, frameAmount - 1);
+    for (size_t i = 0; i < COOLING_ATTEMPTS && cooling < target; i++) {
+        const size_t index = distribution(engine);
+        auto& page = *buffer[index];
+        // (parents of swizzled pages stay hot)
+        if (page.pinned != 0 || page.swizzledChildren != 0 || page.policyState[0] != 0 ||
+            page.id == Page<PAGE_SIZE>::INVALID_ID) {
+            continue;
+        }
+        // accesses through the parent have to find the page through the page
+        // table from now on
+        if (!page.deleted && !unswizzle(page)) {
+            continue;
+        }
+        page.policyState[0] = ++tags;
+        cooling++;
+        fifo.push_back({index, page.id, tags});
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool CoolingPolicy<PAGE_SIZE>::valid(const Entry& entry, size_t frames) const {
+    if (entry.index >= frames) {
+        return false;
+    }
+    const auto& page = *buffer[entry.index];
+    return page.policyState[0].load(std::memory_order_relaxed) == entry.tag && page.id == entry.id;
+}
+// --------------------------------------------------------------------------
+} // namespace buffer
+// --------------------------------------------------------------------------
+#endif //BTREE_REPLACEMENT_H
@@ -0,0 +1,480 @@
+#ifndef BTREE_HEAPFILE_H
+#define BTREE_HEAPFILE_H
+// --------------------------------------------------------------------------
+#include "src/buffer/BufferManager.h"
+#include <array>
+#include <cassert>
+#include <cinttypes>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+// --------------------------------------------------------------------------
+namespace heap {
+// --------------------------------------------------------------------------
+// a record id (tid) stores the page id in the upper and the slot in the
+// lower bits; thus, it fits into the child slot of a leaf
+static constexpr size_t SLOT_BITS = 16;
+inline uint64_t makeTID(uint64_t pageID, uint16_t slot) {
+    return (pageID << SLOT_BITS) | slot;
+}
+inline uint64_t getPageID(uint64_t tid) {
+    return tid >> SLOT_BITS;
+}
+inline uint16_t getSlot(uint64_t tid) {
+    return static_cast<uint16_t>(tid & ((uint64_t(1) << SLOT_BITS) - 1));
+}
+// --------------------------------------------------------------------------
+template <class T>
+// converts values into records (and back)
+struct Serializer {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static std::string_view toBytes(const T& value) {
+        return {reinterpret_cast<const char*>(&value), sizeof(T)};
+    }
+    static T fromBytes(std::string_view bytes) {
+        assert(bytes.size() == sizeof(T));
+        T value;
+        std::memcpy(&value, bytes.data(), sizeof(T));
+        return value;
+    }
+};
+// --------------------------------------------------------------------------
+template <>
+// strings are stored with their actual length
+struct Serializer<std::string> {
+    static std::string_view toBytes(const std::string& value) {
+        return value;
+    }
+    static std::string fromBytes(std::string_view bytes) {
+        return std::string(bytes);
+    }
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+// the slots grow from the front of the page, the records from its back
+class SlottedPage {
+    public:
+    struct Slot {
+        uint16_t offset;
+        uint16_t length;
+    };
+    // marks unused slots
+    static constexpr uint16_t FREE = std::numeric_limits<uint16_t>::max();
+
+    private:
+    uint16_t slotCount;
+    uint16_t usedSlots;
+    // records are stored in [dataStart, data.size())
+    uint16_t dataStart;
+    // space of erased (or shrunk) records which is only usable after compaction
+    uint16_t fragmented;
+    alignas(Slot) std::array<char, PAGE_SIZE - 4 * sizeof(uint16_t)> data;
+
+    public:
+    static_assert(PAGE_SIZE <= FREE);
+    // largest record which fits into an empty page
+    static constexpr size_t MAX_RECORD_SIZE = sizeof(data) - sizeof(Slot);
+
+    private:
+    Slot* slots();
+    const Slot* slots() const;
+    size_t contiguousSpace() const;
+    void compact();
+
+    public:
+    SlottedPage();
+    bool empty() const;
+    // space for records and slots (after compaction)
+    size_t freeSpace() const;
+    // returns the slot of the new record (if there is enough space)
+    std::optional<uint16_t> insert(std::string_view);
+    std::string_view read(uint16_t) const;
+    // replaces the record if the page has enough space for the new version
+    bool update(uint16_t, std::string_view);
+    void erase(uint16_t);
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE = 4096>
+// buffer-managed heap file of slotted pages; the caller has to synchronize
+// the accesses to each record (e.g. through the leaf that references it)
+class HeapFile {
+    public:
+    static constexpr size_t MAX_RECORD_SIZE = SlottedPage<PAGE_SIZE>::MAX_RECORD_SIZE;
+    // pages must fit into the frames of the buffer manager
+    static_assert(sizeof(SlottedPage<PAGE_SIZE>) <= PAGE_SIZE);
+    static_assert(alignof(SlottedPage<PAGE_SIZE>) <= alignof(disk::Frame<PAGE_SIZE>));
+
+    private:
+#ifdef LOGGING
+    public:
+#endif
+    buffer::BufferManager<PAGE_SIZE> bufferManager;
+    // pages with at least this much free space are reused for inserts
+    static constexpr size_t REUSE_THRESHOLD = sizeof(SlottedPage<PAGE_SIZE>) / 4;
+    // new records are appended to this page
+    std::mutex insertMutex;
+    std::optional<uint64_t> insertPage;
+    // free-space map of the other pages below the fill threshold (only kept
+    // in memory); the amounts may be stale, inserts correct them
+    std::multimap<size_t, uint64_t> freePages;
+    std::unordered_map<uint64_t, std::multimap<size_t, uint64_t>::iterator> freePageEntries;
+
+    public:
+    // the buffer holds the given amount of pages
+    HeapFile(const std::string&, size_t, disk::IOConfig ioConfig = {},
+             buffer::Replacement replacement = buffer::Replacement::Clock, buffer::BufferConfig bufferConfig = {});
+    ~HeapFile();
+
+    private:
+    static SlottedPage<PAGE_SIZE>& getSlottedPage(buffer::Page<PAGE_SIZE>&);
+    buffer::Page<PAGE_SIZE>* pin(uint64_t);
+    // updates the free-space map; the insert mutex must be held
+    void setFreeSpace(uint64_t, size_t);
+    // inserts into the given page and returns its remaining free space
+    std::optional<uint16_t> tryInsert(uint64_t, std::string_view, size_t&);
+    // called after an erase freed space on the pinned page
+    void freed(buffer::Page<PAGE_SIZE>&);
+
+    public:
+    size_t pageAmount() const;
+    // resizes the buffer to the amount of pages that fit into the given bytes
+    void setMemoryBudget(size_t);
+    // returns the tid of the new record
+    uint64_t insert(std::string_view);
+    // calls the function with the bytes of the record; the function must
+    // not access the heap file
+    void read(uint64_t, const std::function<void(std::string_view)>&);
+    // loads the pages of the records in one batch (before they are read)
+    void prefetch(const std::vector<uint64_t>&);
+    // returns the (possibly new) tid of the record
+    uint64_t update(uint64_t, std::string_view);
+    void erase(uint64_t);
+};
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+SlottedPage<PAGE_SIZE>::SlottedPage() : slotCount(0), usedSlots(0), dataStart(sizeof(data)), fragmented(0) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+typename SlottedPage<PAGE_SIZE>::Slot* SlottedPage<PAGE_SIZE>::slots() {
+    return reinterpret_cast<Slot*>(data.data());
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+const typename SlottedPage<PAGE_SIZE>::Slot* SlottedPage<PAGE_SIZE>::slots() const {
+    return reinterpret_cast<const Slot*>(data.data());
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+size_t SlottedPage<PAGE_SIZE>::contiguousSpace() const {
+    return dataStart - slotCount * sizeof(Slot);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void SlottedPage<PAGE_SIZE>::compact() {
+    // move all records to the back of a copy
+    std::array<char, sizeof(data)> copy;
+    size_t end = sizeof(data);
+    for (size_t i = 0; i < slotCount; i++) {
+        Slot& slot = slots()[i];
+        if (slot.offset == FREE) {
+            continue;
+        }
+        end -= slot.length;
+        std::memcpy(copy.data() + end, data.data() + slot.offset, slot.length);
+        slot.offset = end;
+    }
+    std::memcpy(data.data() + end, copy.data() + end, sizeof(data) - end);
+    dataStart = end;
+    fragmented = 0;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool SlottedPage<PAGE_SIZE>::empty() const {
+    return usedSlots == 0;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+size_t SlottedPage<PAGE_SIZE>::freeSpace() const {
+    return contiguousSpace() + fragmented;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+std::optional<uint16_t> SlottedPage<PAGE_SIZE>::insert(std::string_view bytes) {
+    // reuse a free slot if possible
+    size_t index = 0;
+    while (index < slotCount && slots()[index].offset != FREE) {
+        index++;
+    }
+    const size_t required = bytes.size() + (index == slotCount ? sizeof(Slot) : 0);
+    if (contiguousSpace() + fragmented < required) {
+        return std::nullopt;
+    }
+    if (contiguousSpace() < required) {
+        compact();
+    }
+    if (index == slotCount) {
+        slotCount++;
+    }
+    dataStart -= bytes.size();
+    std::memcpy(data.data() + dataStart, bytes.data(), bytes.size());
+    slots()[index] = {dataStart, static_cast<uint16_t>(bytes.size())};
+    usedSlots++;
+    return index;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+std::string_view SlottedPage<PAGE_SIZE>::read(uint16_t index) const {
+    assert(index < slotCount && slots()[index].offset != FREE);
+    const Slot& slot = slots()[index];
+    return {data.data() + slot.offset, slot.length};
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+bool SlottedPage<PAGE_SIZE>::update(uint16_t index, std::string_view bytes) {
+    assert(index < slotCount && slots()[index].offset != FREE);
+    Slot& slot = slots()[index];
+    if (bytes.size() <= slot.length) {
+        // shrink in place
+        std::memcpy(data.data() + slot.offset, bytes.data(), bytes.size());
+        fragmented += slot.length - bytes.size();
+        slot.length = bytes.size();
+        return true;
+    }
+    if (contiguousSpace() + fragmented + slot.length < bytes.size()) {
+        return false;
+    }
+    // release the old version and store the new one at the front of the records
+    fragmented += slot.length;
+    slot.offset = FREE;
+    if (contiguousSpace() < bytes.size()) {
+        compact();
+    }
+    dataStart -= bytes.size();
+    std::memcpy(data.data() + dataStart, bytes.data(), bytes.size());
+    slot = {dataStart, static_cast<uint16_t>(bytes.size())};
+    return true;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void SlottedPage<PAGE_SIZE>::erase(uint16_t index) {
+    assert(index < slotCount && slots()[index].offset != FREE);
+    Slot& slot = slots()[index];
+    fragmented += slot.length;
+    slot.offset = FREE;
+    usedSlots--;
+    // trailing slots can be removed entirely
+    while (slotCount > 0 && slots()[slotCount - 1].offset == FREE) {
+        slotCount--;
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+HeapFile<PAGE_SIZE>::HeapFile(const std::string& path, size_t pageAmount, disk::IOConfig ioConfig,
+                              buffer::Replacement replacement, buffer::BufferConfig bufferConfig)
+    : bufferManager(path, pageAmount, nullptr, nullptr, nullptr, ioConfig, replacement, nullptr, bufferConfig) {
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+HeapFile<PAGE_SIZE>::~HeapFile() {
+    // the next instance starts a new insert page; an empty one would never be
+    // used (or freed) again
+    if (!insertPage) {
+        return;
+    }
+    buffer::Page<PAGE_SIZE>* page = pin(*insertPage);
+    const bool empty = getSlottedPage(*page).empty();
+    bufferManager.unpinPage(page->id, false);
+    if (empty) {
+        bufferManager.deletePage(*insertPage);
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+SlottedPage<PAGE_SIZE>& HeapFile<PAGE_SIZE>::getSlottedPage(buffer::Page<PAGE_SIZE>& page) {
+    // reinterpret the content (defined behaviour since the frame and its data array are properly aligned)
+    return *reinterpret_cast<SlottedPage<PAGE_SIZE>*>(page.frame.content.data());
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+buffer::Page<PAGE_SIZE>* HeapFile<PAGE_SIZE>::pin(uint64_t id) {
+    buffer::Page<PAGE_SIZE>* page;
+    while (!(page = bufferManager.pinPage(id)))
+        ;
+    return page;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+size_t HeapFile<PAGE_SIZE>::pageAmount() const {
+    return bufferManager.totalFrames();
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void HeapFile<PAGE_SIZE>::setMemoryBudget(size_t bytes) {
+    bufferManager.setMemoryBudget(bytes);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void HeapFile<PAGE_SIZE>::setFreeSpace(uint64_t id, size_t freeSpace) {
+    if (auto it = freePageEntries.find(id); it != freePageEntries.end()) {
+        freePages.erase(it->second);
+        freePageEntries.erase(it);
+    }
+    if (freeSpace >= REUSE_THRESHOLD && insertPage != id) {
+        freePageEntries.emplace(id, freePages.emplace(freeSpace, id));
+    }
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+std::optional<uint16_t> HeapFile<PAGE_SIZE>::tryInsert(uint64_t id, std::string_view bytes, size_t& freeSpace) {
+    buffer::Page<PAGE_SIZE>* page = pin(id);
+    std::unique_lock pageLock(page->mutex);
+    auto& slottedPage = getSlottedPage(*page);
+    const std::optional<uint16_t> slot = slottedPage.insert(bytes);
+    freeSpace = slottedPage.freeSpace();
+    pageLock.unlock();
+    bufferManager.unpinPage(id, slot.has_value());
+    return slot;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+uint64_t HeapFile<PAGE_SIZE>::insert(std::string_view bytes) {
+    if (bytes.size() > MAX_RECORD_SIZE) {
+        throw std::runtime_error("record too large");
+    }
+    std::unique_lock lock(insertMutex);
+    size_t freeSpace;
+    if (insertPage) {
+        if (const std::optional<uint16_t> slot = tryInsert(*insertPage, bytes, freeSpace)) {
+            return makeTID(*insertPage, *slot);
+        }
+        // the current page is full (for this record); it is reused later
+        // if it has enough space left
+        const uint64_t previous = *insertPage;
+        insertPage.reset();
+        setFreeSpace(previous, freeSpace);
+    }
+    // continue with the emptiest page of the map; an insert only fails if the
+    // amount was stale (records grew meanwhile), which corrects it
+    const size_t required = bytes.size() + sizeof(typename SlottedPage<PAGE_SIZE>::Slot);
+    while (!freePages.empty() && freePages.rbegin()->first >= required) {
+        const uint64_t id = freePages.rbegin()->second;
+        insertPage = id;
+        setFreeSpace(id, 0);
+        if (const std::optional<uint16_t> slot = tryInsert(id, bytes, freeSpace)) {
+            return makeTID(id, *slot);
+        }
+        insertPage.reset();
+        setFreeSpace(id, freeSpace);
+    }
+    // no page has enough space; start a new one
+    const uint64_t id = bufferManager.newPage();
+    assert(id < (uint64_t(1) << (64 - SLOT_BITS)));
+    buffer::Page<PAGE_SIZE>* page = pin(id);
+    std::unique_lock pageLock(page->mutex);
+    auto* slottedPage = new (page->frame.content.data()) SlottedPage<PAGE_SIZE>;
+    const std::optional<uint16_t> slot = slottedPage->insert(bytes);
+    assert(slot);
+    pageLock.unlock();
+    bufferManager.unpinPage(id, true);
+    insertPage = id;
+    return makeTID(id, *slot);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void HeapFile<PAGE_SIZE>::read(uint64_t tid, const std::function<void(std::string_view)>& func) {
+    buffer::Page<PAGE_SIZE>* page = pin(getPageID(tid));
+    page->mutex.lock_shared();
+    func(getSlottedPage(*page).read(getSlot(tid)));
+    page->mutex.unlock_shared();
+    bufferManager.unpinPage(page->id, false);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void HeapFile<PAGE_SIZE>::prefetch(const std::vector<uint64_t>& tids) {
+    std::vector<uint64_t> ids;
+    ids.reserve(tids.size());
+    for (uint64_t tid : tids) {
+        // (records of one page are often adjacent)
+        if (ids.empty() || ids.back() != getPageID(tid)) {
+            ids.push_back(getPageID(tid));
+        }
+    }
+    bufferManager.prefetch(ids);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+uint64_t HeapFile<PAGE_SIZE>::update(uint64_t tid, std::string_view bytes) {
+    if (bytes.size() > MAX_RECORD_SIZE) {
+        throw std::runtime_error("record too large");
+    }
+    buffer::Page<PAGE_SIZE>* page = pin(getPageID(tid));
+    page->mutex.lock();
+    const bool updated = getSlottedPage(*page).update(getSlot(tid), bytes);
+    page->mutex.unlock();
+    bufferManager.unpinPage(page->id, updated);
+    if (updated) {
+        return tid;
+    }
+    // the record doesn't fit into its page anymore; move it
+    // (the page latch is released before, since inserts latch the insert page)
+    const uint64_t newTID = insert(bytes);
+    erase(tid);
+    return newTID;
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void HeapFile<PAGE_SIZE>::erase(uint64_t tid) {
+    const uint64_t id = getPageID(tid);
+    buffer::Page<PAGE_SIZE>* page = pin(id);
+    page->mutex.lock();
+    auto& slottedPage = getSlottedPage(*page);
+    const size_t freeBefore = slottedPage.freeSpace();
+    slottedPage.erase(getSlot(tid));
+    const bool empty = slottedPage.empty();
+    const bool reusable = freeBefore < REUSE_THRESHOLD && slottedPage.freeSpace() >= REUSE_THRESHOLD;
+    page->mutex.unlock();
+    // the map only learns about pages crossing the threshold; otherwise, its
+    // amount just underestimates the free space
+    if (empty || reusable) {
+        freed(*page);
+    }
+    bufferManager.unpinPage(id, true);
+}
+// --------------------------------------------------------------------------
+template <size_t PAGE_SIZE>
+void HeapFile<PAGE_SIZE>::freed(buffer::Page<PAGE_SIZE>& page) {
+    // the page is checked again, since inserts (or erases) may have changed
+    // it meanwhile
+    std::unique_lock lock(insertMutex);
+    std::unique_lock pageLock(page.mutex);
+    if (page.deleted) {
+        return;
+    }
+    const auto& slottedPage = getSlottedPage(page);
+    if (!slottedPage.empty() || insertPage == page.id) {
+        setFreeSpace(page.id, slottedPage.freeSpace());
+        return;
+    }
+    // empty pages (except for the insert page, which is freed on destruction
+    // if it is still empty) are never used again
+    setFreeSpace(page.id, 0);
+    lock.unlock();
+    // the latch is held until the page is marked, so that other erases of
+    // the page see it
+    bufferManager.deletePage(page.id);
+}
+// --------------------------------------------------------------------------
+} // namespace heap
+// --------------------------------------------------------------------------
+#endif //BTREE_HEAPFILE_H
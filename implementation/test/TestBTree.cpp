@@ -37,7 +37,7 @@ array<char, 128> generateRandomString(){
 // --------------------------------------------------------------------------
 TEST(BTree, StoreData_1) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     for(uint32_t i = 0; i < 1000; i += 2){
         tree.insert(i, i * 2);
     }
@@ -56,7 +56,7 @@ TEST(BTree, StoreData_1) {
 // --------------------------------------------------------------------------
 TEST(BTree, StoreData_2) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     for(int i = 1000; i >= 0; i -= 2){
         tree.insert(i, i * 2);
     }
@@ -75,7 +75,7 @@ TEST(BTree, StoreData_2) {
 // --------------------------------------------------------------------------
 TEST(BTree, StoreDataRandom) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     std::vector<KEY> keys;
     for(KEY key = 0; key < 1000; key++){
         keys.push_back(key);
@@ -97,7 +97,7 @@ TEST(BTree, StoreDataRandom) {
 // --------------------------------------------------------------------------
 TEST(BTree, StoreDataMultiThreaded) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     vector<thread> threads;
     for(size_t i = 0; i < 100 * 1000; i += 1000){
         threads.emplace_back([&tree, i](){
@@ -120,7 +120,7 @@ TEST(BTree, StoreDataMultiThreaded) {
 // --------------------------------------------------------------------------
 TEST(BTree, StoreDataMultiThreadedLarge) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     vector<thread> threads;
     for(size_t i = 0; i < 100 * 10000; i += 10000){
         threads.emplace_back([&tree, i](){
@@ -148,13 +148,14 @@ TEST(BTree, KeepsData) {
     auto rng = std::default_random_engine();
     std::shuffle(keys.begin(), keys.end(), rng);
     {
-        BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+        BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
         for(KEY key : keys){
             tree.insert(key, key * 2);
         }
         // destructor
     }
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    EXPECT_EQ(tree.size(), 1000);
     for(KEY key : keys){
         EXPECT_TRUE(tree.contains(key));
     }
@@ -167,7 +168,7 @@ TEST(BTree, KeepsData) {
 // --------------------------------------------------------------------------
 TEST(BTree, Update) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     for(size_t i = 0; i < 1000; i++){
         tree.insert(i, i);
     }
@@ -181,7 +182,7 @@ TEST(BTree, Update) {
 // --------------------------------------------------------------------------
 TEST(BTree, UpdateLarge) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     vector<KEY> keys;
     for(size_t i = 0; i < 50 * 1000; i++){
         keys.push_back(i);
@@ -208,7 +209,7 @@ TEST(BTree, UpdateLarge) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_1) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     vector<KEY> keys;
     for(size_t i = 0; i < 50 * 1000; i++){
         keys.push_back(i);
@@ -243,7 +244,7 @@ TEST(BTree, MultiThreadedUpdate_1) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_2) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     vector<thread> threads;
     for(size_t i = 0; i < 50 * 1000; i += 1000){
         threads.emplace_back([&tree, i](){
@@ -271,7 +272,7 @@ TEST(BTree, MultiThreadedUpdate_2) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_3) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     for(size_t i = 0; i < 500; i++){
         tree.insert(i, i * 2);
     }
@@ -294,7 +295,7 @@ TEST(BTree, MultiThreadedUpdate_3) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_4_Both) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     vector<thread> threads;
     array<size_t, 10> COUNTER;
     COUNTER.fill(0);
@@ -334,7 +335,7 @@ TEST(BTree, MultiThreadedUpdate_4_Both) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_4_ContentionOnly) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, false);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, false);
     vector<thread> threads;
     array<size_t, 10> COUNTER;
     COUNTER.fill(0);
@@ -374,7 +375,7 @@ TEST(BTree, MultiThreadedUpdate_4_ContentionOnly) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_4_XMergeOnly) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, false, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, false, true);
     vector<thread> threads;
     array<size_t, 10> COUNTER;
     COUNTER.fill(0);
@@ -414,7 +415,7 @@ TEST(BTree, MultiThreadedUpdate_4_XMergeOnly) {
 // --------------------------------------------------------------------------
 TEST(BTree, MultiThreadedUpdate_4_Normal) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, false, false);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, false, false);
     vector<thread> threads;
     array<size_t, 10> COUNTER;
     COUNTER.fill(0);
@@ -455,7 +456,7 @@ TEST(BTree, MultiThreadedUpdate_4_Normal) {
 TEST(BTree, MultiThreadedUpdateString_1) {
     setup();
     using DATA = array<char, 128>;
-    BTree<KEY, DATA, 500, 1024> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, 1024> tree(BTREE_FILENAME, DATA_FILENAME, 500, true, true);
     vector<thread> threads;
 
     for(size_t i = 0; i < 1 * 1000000; i += 1000000){
@@ -476,7 +477,7 @@ TEST(BTree, MultiThreadedUpdateString_1) {
 TEST(BTree, MultiThreadedUpdateString_2) {
     setup();
     using DATA = array<char, 128>;
-    BTree<KEY, DATA, 500, 1024> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, 1024> tree(BTREE_FILENAME, DATA_FILENAME, 500, true, true);
     vector<thread> threads;
     for(size_t i = 0; i < 4 * 250000; i += 250000){
         threads.emplace_back([&tree, i](){
@@ -493,9 +494,36 @@ TEST(BTree, MultiThreadedUpdateString_2) {
     }
 }
 // --------------------------------------------------------------------------
+TEST(BTree, MemoryBudget) {
+    setup();
+    using DATA = array<char, 128>;
+    using Tree = BTree<KEY, DATA, 1024>;
+    Tree tree(BTREE_FILENAME, DATA_FILENAME, 400, true, true, true, {}, buffer::Replacement::Clock,
+              {.maxFrames = 800});
+    EXPECT_EQ(tree.bufferManager.bufferFrames(), 400 - 400 * Tree::HEAP_PERCENTAGE / 100);
+    for(KEY key = 0; key < 20000; key++){
+        DATA data;
+        data.fill(key % 100);
+        tree.insert(key, data);
+    }
+    // a quarter of the bytes for the nodes, the rest for the records
+    const size_t frames = 100;
+    tree.setMemoryBudget(frames * sizeof(buffer::Page<Tree::PAGE_SIZE>) * 100 / (100 - Tree::HEAP_PERCENTAGE));
+    EXPECT_EQ(tree.bufferManager.bufferFrames(), frames);
+    for(KEY key = 0; key < 20000; key += 7){
+        auto data = tree.find(key);
+        ASSERT_TRUE(data);
+        EXPECT_EQ((*data)[0], key % 100);
+    }
+    // grow up to the maximum
+    tree.setMemoryBudget(800 * sizeof(buffer::Page<Tree::PAGE_SIZE>));
+    EXPECT_EQ(tree.bufferManager.bufferFrames(), 800 - 800 * Tree::HEAP_PERCENTAGE / 100);
+    EXPECT_EQ(tree.size(), 20000);
+}
+// --------------------------------------------------------------------------
 TEST(BTree, CheckSize) {
     setup();
-    BTree<KEY, DATA, PAGE_AMOUNT, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, true, true);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
     std::vector<KEY> keys;
     for(KEY key = 0; key < 1000; key++){
         keys.push_back(key);
@@ -507,4 +535,543 @@ TEST(BTree, CheckSize) {
     }
     // tree was built, check
     EXPECT_EQ(tree.size(), 1000);
-}
\ No newline at end of file
+}
+// --------------------------------------------------------------------------
+TEST(BTree, VariableLengthData) {
+    setup();
+    using DATA = string;
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    for(KEY key = 0; key < 5000; key++){
+        tree.insert(key, string(key % 500, 'a' + key % 26));
+    }
+    // grow some records (which moves them if their pages are full)
+    for(KEY key = 0; key < 5000; key += 3){
+        EXPECT_TRUE(tree.update(key, [](DATA& data){
+            data += string(1000, '+');
+        }));
+    }
+    for(KEY key = 1; key < 5000; key += 3){
+        EXPECT_TRUE(tree.erase(key));
+    }
+    for(KEY key = 0; key < 5000; key++){
+        auto data = std::move(tree.find(key));
+        if(key % 3 == 1){
+            EXPECT_FALSE(data);
+            continue;
+        }
+        ASSERT_TRUE(data);
+        string expected(key % 500, 'a' + key % 26);
+        if(key % 3 == 0){
+            expected += string(1000, '+');
+        }
+        EXPECT_EQ(*data, expected);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, LargeData) {
+    setup();
+    // too large to be stored inline
+    using DATA = array<uint64_t, 10>;
+    static_assert(!BTree<KEY, DATA, 512>::INLINE_DATA);
+    BTree<KEY, DATA, 512> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    for(KEY key = 0; key < 2000; key++){
+        tree.insert(key, {key, key + 1, key + 2, key + 3});
+    }
+    for(KEY key = 0; key < 2000; key += 2){
+        EXPECT_TRUE(tree.update(key, [](DATA& data){
+            data[3] = 42;
+        }));
+    }
+    for(KEY key = 1; key < 2000; key += 4){
+        EXPECT_TRUE(tree.erase(key));
+    }
+    EXPECT_EQ(tree.size(), 1500);
+    for(KEY key = 0; key < 2000; key++){
+        auto data = std::move(tree.find(key));
+        if(key % 4 == 1){
+            EXPECT_FALSE(data);
+            continue;
+        }
+        ASSERT_TRUE(data);
+        EXPECT_EQ((*data)[0], key);
+        EXPECT_EQ((*data)[3], key % 2 == 0 ? 42 : key + 3);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, WideInlineData) {
+    setup();
+    // stored inline in wider leaf slots
+    using DATA = array<uint64_t, 4>;
+    static_assert(BTree<KEY, DATA, 512>::INLINE_DATA);
+    // the inner nodes keep their fanout
+    static_assert(BTree<KEY, DATA, 512>::KEYS_PER_INNER_NODE > 2 * BTree<KEY, DATA, 512>::KEYS_PER_LEAF);
+    BTree<KEY, DATA, 512> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    EXPECT_FALSE(tree.heapFile);
+    vector<KEY> keys;
+    for(KEY key = 0; key < 20000; key++){
+        keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine());
+    for(KEY key : keys){
+        tree.insert(key, {key, key + 1, key + 2, key + 3});
+    }
+    for(KEY key = 0; key < 20000; key += 2){
+        EXPECT_TRUE(tree.update(key, [](DATA& data){
+            data[3] = 42;
+        }));
+    }
+    for(KEY key = 1; key < 20000; key += 4){
+        EXPECT_TRUE(tree.erase(key));
+    }
+    EXPECT_EQ(tree.size(), 15000);
+    for(KEY key = 0; key < 20000; key++){
+        auto data = std::move(tree.find(key));
+        if(key % 4 == 1){
+            EXPECT_FALSE(data);
+            continue;
+        }
+        ASSERT_TRUE(data);
+        EXPECT_EQ((*data)[0], key);
+        EXPECT_EQ((*data)[2], key + 2);
+        EXPECT_EQ((*data)[3], key % 2 == 0 ? 42 : key + 3);
+    }
+    // the tuples are moved along with their keys
+    KEY previous = 0;
+    size_t scanned = tree.scan(0, 20000, [&previous](const KEY& key, const DATA& data){
+        EXPECT_GE(key, previous);
+        EXPECT_EQ(data[0], key);
+        previous = key;
+    });
+    EXPECT_EQ(scanned, 15000);
+}
+// --------------------------------------------------------------------------
+TEST(BTree, PessimisticReads) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true, false);
+    std::vector<KEY> keys;
+    for(KEY key = 0; key < 1000; key++){
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine();
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for(KEY key : keys){
+        tree.insert(key, key * 2);
+    }
+    for(KEY key : keys){
+        EXPECT_TRUE(tree.contains(key));
+        EXPECT_TRUE(tree.update(key, [](DATA& data){
+            data++;
+        }));
+        auto data = std::move(tree.find(key));
+        EXPECT_TRUE(data);
+        EXPECT_EQ(*data, key * 2 + 1);
+    }
+    EXPECT_FALSE(tree.contains(1000));
+}
+// --------------------------------------------------------------------------
+TEST(BTree, MultiThreadedReadWhileInsert) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    std::atomic<KEY> inserted = 0;
+    vector<thread> threads;
+    threads.emplace_back([&tree, &inserted](){
+        for(KEY key = 0; key < 50 * 1000; key++){
+            tree.insert(key, key * 2);
+            inserted = key + 1;
+        }
+    });
+    for(size_t i = 0; i < 8; i++){
+        threads.emplace_back([&tree, &inserted](){
+            std::default_random_engine engine;
+            while(inserted < 50 * 1000){
+                const KEY limit = inserted;
+                if(limit == 0){
+                    continue;
+                }
+                // every key below the limit must be visible
+                const KEY key = engine() % limit;
+                auto data = std::move(tree.find(key));
+                ASSERT_TRUE(data);
+                EXPECT_EQ(*data, key * 2);
+                EXPECT_TRUE(tree.contains(key));
+            }
+        });
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, Scan) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    std::vector<KEY> keys;
+    for(KEY key = 0; key < 10000; key += 2){
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine();
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for(KEY key : keys){
+        tree.insert(key, key * 2);
+    }
+    for(KEY start = 0; start < 10000; start += 333){
+        KEY expected = start + start % 2;
+        size_t scanned = tree.scan(start, 100, [&expected](const KEY& key, const DATA& data){
+            EXPECT_EQ(key, expected);
+            EXPECT_EQ(data, key * 2);
+            expected += 2;
+        });
+        EXPECT_EQ(scanned, std::min<size_t>(100, (10000 - (start + start % 2)) / 2));
+    }
+    // the whole tree
+    KEY expected = 0;
+    EXPECT_EQ(tree.scan(0, 100000, [&expected](const KEY& key, const DATA&){
+        EXPECT_EQ(key, expected);
+        expected += 2;
+    }), 5000);
+    EXPECT_EQ(tree.scan(10000, 10, [](const KEY&, const DATA&){}), 0);
+}
+// --------------------------------------------------------------------------
+TEST(BTree, MultiThreadedScan) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    // odd keys are present from the beginning, even keys are inserted concurrently
+    for(KEY key = 1; key < 20 * 1000; key += 2){
+        tree.insert(key, key);
+    }
+    vector<thread> threads;
+    for(size_t i = 0; i < 20 * 1000; i += 1000){
+        threads.emplace_back([&tree, i](){
+            for(KEY key = i; key < i + 1000; key += 2){
+                tree.insert(key, key);
+                EXPECT_TRUE(tree.update(key + 1, [](DATA& data){
+                    data++;
+                }));
+            }
+        });
+    }
+    for(size_t i = 0; i < 4; i++){
+        threads.emplace_back([&tree](){
+            for(size_t j = 0; j < 50; j++){
+                KEY last = 0;
+                size_t odd = 0;
+                tree.scan(0, 100000, [&last, &odd](const KEY& key, const DATA&){
+                    EXPECT_TRUE(key == 0 || key > last);
+                    last = key;
+                    odd += key % 2;
+                });
+                // no pre-existing key may be skipped
+                EXPECT_EQ(odd, 10 * 1000);
+            }
+        });
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+    KEY expected = 0;
+    tree.scan(0, 100000, [&expected](const KEY& key, const DATA& data){
+        EXPECT_EQ(key, expected);
+        EXPECT_EQ(data, key + key % 2);
+        expected++;
+    });
+    EXPECT_EQ(expected, 20 * 1000);
+}
+// --------------------------------------------------------------------------
+TEST(BTree, Erase) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    std::vector<KEY> keys;
+    for(KEY key = 0; key < 5000; key++){
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine();
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for(KEY key : keys){
+        tree.insert(key, key * 2);
+    }
+    // erase all odd keys
+    for(KEY key : keys){
+        if(key % 2 == 1){
+            EXPECT_TRUE(tree.erase(key));
+        }
+    }
+    EXPECT_EQ(tree.size(), 2500);
+    for(KEY key = 0; key < 5000; key++){
+        EXPECT_EQ(tree.contains(key), key % 2 == 0);
+        if(key % 2 == 1){
+            EXPECT_FALSE(tree.erase(key));
+        }
+    }
+    KEY expected = 0;
+    EXPECT_EQ(tree.scan(0, 5000, [&expected](const KEY& key, const DATA& data){
+        EXPECT_EQ(key, expected);
+        EXPECT_EQ(data, key * 2);
+        expected += 2;
+    }), 2500);
+    // erase everything
+    for(KEY key : keys){
+        tree.erase(key);
+    }
+    EXPECT_EQ(tree.size(), 0);
+    EXPECT_FALSE(tree.find(0));
+    // underfull nodes were merged up to the root
+    auto* rootPage = tree.bufferManager.pinPage(tree.root);
+    EXPECT_FALSE(tree.isInnerNode(rootPage));
+    tree.bufferManager.unpinPage(tree.root, false);
+    // the tree is still usable
+    for(KEY key : keys){
+        tree.insert(key, key);
+    }
+    for(KEY key : keys){
+        auto data = std::move(tree.find(key));
+        EXPECT_TRUE(data);
+        EXPECT_EQ(*data, key);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, MultiThreadedErase) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    for(KEY key = 0; key < 50 * 1000; key++){
+        tree.insert(key, key);
+    }
+    vector<thread> threads;
+    for(size_t i = 0; i < 50 * 1000; i += 1000){
+        threads.emplace_back([&tree, i](){
+            // erase three quarters of the own range and re-insert some keys
+            for(KEY key = i; key < i + 1000; key++){
+                if(key % 4 != 0){
+                    EXPECT_TRUE(tree.erase(key));
+                    EXPECT_FALSE(tree.contains(key));
+                }
+                if(key % 8 == 1){
+                    tree.insert(key, key * 2);
+                }
+                EXPECT_TRUE(tree.update(i, [](DATA&){}));
+            }
+        });
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+    for(KEY key = 0; key < 50 * 1000; key++){
+        auto data = std::move(tree.find(key));
+        if(key % 4 == 0){
+            ASSERT_TRUE(data);
+            EXPECT_EQ(*data, key);
+        } else if(key % 8 == 1){
+            ASSERT_TRUE(data);
+            EXPECT_EQ(*data, key * 2);
+        } else {
+            EXPECT_FALSE(data);
+        }
+    }
+    EXPECT_EQ(tree.size(), 50 * 1000 / 4 + 50 * 1000 / 8);
+}
+// --------------------------------------------------------------------------
+namespace {
+// --------------------------------------------------------------------------
+template <class T>
+void checkKeySearch(const vector<T>& keys, const vector<T>& needles) {
+    for (size_t amount = 0; amount <= keys.size(); amount++) {
+        for (const T& needle : needles) {
+            const size_t lower = lower_bound(keys.begin(), keys.begin() + amount, needle) - keys.begin();
+            const size_t upper = upper_bound(keys.begin(), keys.begin() + amount, needle) - keys.begin();
+            ASSERT_EQ(lowerBound(keys.data(), amount, needle), lower);
+            ASSERT_EQ(upperBound(keys.data(), amount, needle), upper);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+} // namespace
+// --------------------------------------------------------------------------
+TEST(BTree, KeySearch) {
+    mt19937_64 gen(42);
+    {
+        // includes duplicates and negative values
+        vector<int32_t> keys;
+        for (int32_t i = -40; i < 40; i++) {
+            keys.push_back(i - i % 3);
+        }
+        sort(keys.begin(), keys.end());
+        checkKeySearch<int32_t>(keys, {-100, -41, -40, -39, -3, 0, 1, 2, 37, 38, 39, 100});
+    }
+    {
+        // values above the signed range
+        vector<uint32_t> keys;
+        for (size_t i = 0; i < 70; i++) {
+            keys.push_back(static_cast<uint32_t>(gen()));
+        }
+        keys.push_back(0);
+        keys.push_back(numeric_limits<uint32_t>::max());
+        sort(keys.begin(), keys.end());
+        vector<uint32_t> needles(keys.begin(), keys.end());
+        needles.push_back(1u << 31);
+        needles.push_back((1u << 31) - 1);
+        checkKeySearch(keys, needles);
+    }
+    {
+        vector<uint64_t> keys;
+        for (size_t i = 0; i < 70; i++) {
+            keys.push_back(gen());
+        }
+        sort(keys.begin(), keys.end());
+        vector<uint64_t> needles(keys.begin(), keys.end());
+        needles.push_back(0);
+        needles.push_back(numeric_limits<uint64_t>::max());
+        needles.push_back(keys[10] + 1);
+        checkKeySearch(keys, needles);
+    }
+    {
+        // keys without vector support use the scalar path
+        vector<array<uint8_t, 3>> keys;
+        for (uint8_t i = 0; i < 50; i++) {
+            keys.push_back({static_cast<uint8_t>(i / 10), static_cast<uint8_t>(i % 10), 0});
+        }
+        vector<array<uint8_t, 3>> needles(keys.begin(), keys.end());
+        needles.push_back({2, 5, 1});
+        needles.push_back({9, 9, 9});
+        checkKeySearch(keys, needles);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, Swizzling) {
+    setup();
+    // few frames, so that swizzled pages are evicted all the time
+    constexpr size_t FRAMES = 100;
+    std::vector<KEY> keys;
+    for(KEY key = 0; key < 20 * 1000; key++){
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine();
+    std::shuffle(keys.begin(), keys.end(), rng);
+    {
+        BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, FRAMES, true, true);
+        vector<thread> threads;
+        for(size_t t = 0; t < 4; t++){
+            threads.emplace_back([&tree, &keys, t](){
+                for(size_t i = t; i < keys.size(); i += 4){
+                    tree.insert(keys[i], keys[i] * 2);
+                }
+                for(size_t i = 0; i < keys.size(); i += 4){
+                    auto data = tree.find(keys[i]);
+                    EXPECT_TRUE(data);
+                    EXPECT_EQ(*data, keys[i] * 2);
+                }
+            });
+        }
+        for(auto& t : threads){
+            t.join();
+        }
+        // the children of the root are hot
+        auto* rootPage = tree.bufferManager.pinPage(tree.root);
+        EXPECT_GT(rootPage->swizzledChildren, 0);
+        tree.bufferManager.unpinPage(tree.root, false);
+        // destructor (writes back the ids)
+    }
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, FRAMES, true, true);
+    EXPECT_EQ(tree.size(), keys.size());
+    for(KEY key : keys){
+        auto data = tree.find(key);
+        EXPECT_TRUE(data);
+        EXPECT_EQ(*data, key * 2);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, CoolingStage) {
+    setup();
+    // cooling unswizzles pages while x-merge restructures them
+    constexpr size_t FRAMES = 100;
+    std::vector<KEY> keys;
+    for(KEY key = 0; key < 20 * 1000; key++){
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine();
+    std::shuffle(keys.begin(), keys.end(), rng);
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, FRAMES, true, true, true, {},
+                                           buffer::Replacement::Cooling);
+    vector<thread> threads;
+    for(size_t t = 0; t < 4; t++){
+        threads.emplace_back([&tree, &keys, t](){
+            for(size_t i = t; i < keys.size(); i += 4){
+                tree.insert(keys[i], keys[i] * 2);
+            }
+            for(size_t i = 0; i < keys.size(); i += 4){
+                auto data = tree.find(keys[i]);
+                EXPECT_TRUE(data);
+                EXPECT_EQ(*data, keys[i] * 2);
+            }
+        });
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+    EXPECT_EQ(tree.size(), keys.size());
+    for(KEY key : keys){
+        auto data = tree.find(key);
+        EXPECT_TRUE(data);
+        EXPECT_EQ(*data, key * 2);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, BulkLoad) {
+    setup();
+    constexpr size_t FRAMES = 100;
+    std::vector<std::pair<KEY, DATA>> tuples;
+    for(KEY key = 0; key < 100 * 1000; key += 2){
+        tuples.emplace_back(key, key * 2);
+    }
+    {
+        BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, FRAMES, true, true);
+        tree.bulkLoad(tuples, 0.7);
+        EXPECT_EQ(tree.size(), tuples.size());
+        KEY expected = 0;
+        EXPECT_EQ(tree.scan(0, 100 * 1000, [&expected](const KEY& key, const DATA& data){
+            EXPECT_EQ(key, expected);
+            EXPECT_EQ(data, key * 2);
+            expected += 2;
+        }), tuples.size());
+        // the free space is used by later inserts
+        for(KEY key = 1; key < 100 * 1000; key += 20){
+            tree.insert(key, key * 2);
+        }
+        for(KEY key = 0; key < 100 * 1000; key += 10){
+            EXPECT_TRUE(tree.erase(key));
+        }
+        EXPECT_EQ(tree.size(), tuples.size() - 5000);
+        // destructor
+    }
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, FRAMES, true, true);
+    EXPECT_EQ(tree.size(), tuples.size() - 5000);
+    for(KEY key = 0; key < 100 * 1000; key++){
+        auto data = tree.find(key);
+        EXPECT_EQ(data.has_value(), key % 10 != 0 && (key % 2 == 0 || key % 20 == 1));
+        if(data){
+            EXPECT_EQ(*data, key * 2);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BTree, BulkLoadSmall) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    // fits into the root
+    std::vector<std::pair<KEY, DATA>> tuples{{1, 2}, {2, 4}, {3, 6}};
+    tree.bulkLoad(tuples);
+    EXPECT_EQ(tree.size(), 3);
+    EXPECT_FALSE(tree.isInnerNode(tree.bufferManager.pinPage(tree.root)));
+    tree.bufferManager.unpinPage(tree.root, false);
+    for(const auto& [key, data] : tuples){
+        EXPECT_EQ(tree.find(key), data);
+    }
+    // only empty trees can be loaded
+    EXPECT_THROW(tree.bulkLoad(tuples), std::runtime_error);
+}
+// --------------------------------------------------------------------------
+TEST(BTree, BulkLoadUnsorted) {
+    setup();
+    BTree<KEY, DATA, TOTAL_PAGE_SIZE> tree(BTREE_FILENAME, DATA_FILENAME, PAGE_AMOUNT, true, true);
+    std::vector<std::pair<KEY, DATA>> tuples{{1, 2}, {3, 6}, {2, 4}};
+    EXPECT_THROW(tree.bulkLoad(tuples), std::runtime_error);
+    EXPECT_EQ(tree.size(), 0);
+}
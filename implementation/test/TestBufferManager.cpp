@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 // --------------------------------------------------------------------------
 #include "src/buffer/BufferManager.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <unordered_set>
 // --------------------------------------------------------------------------
@@ -21,7 +23,7 @@ void setup() {
 // --------------------------------------------------------------------------
 TEST(BufferManager, StoreData) {
     setup();
-    BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager(FILENAME);
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
     unordered_set<uint64_t> ids;
 
     for (size_t i = 0; i < 2000; i++) {
@@ -43,7 +45,7 @@ TEST(BufferManager, StoreData) {
 // --------------------------------------------------------------------------
 TEST(BufferManager, StoreMultithreaded) {
     setup();
-    BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager(FILENAME);
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
     std::vector<std::thread> threads;
 
     for (size_t i = 0; i < 10000; i++) {
@@ -66,8 +68,7 @@ TEST(BufferManager, StoreMultithreaded) {
                 }
                 EXPECT_EQ(page->frame.content[0], i % 100);
                 bufferManager.unpinPage(id, false);
-                while (!bufferManager.deletePage(id))
-                    ;
+                bufferManager.deletePage(id);
                 break;
             }
         });
@@ -80,7 +81,7 @@ TEST(BufferManager, StoreMultithreaded) {
 // --------------------------------------------------------------------------
 TEST(BufferManager, StoreMultithreadedSamePage) {
     setup();
-    BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager(FILENAME);
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
     std::vector<std::thread> threads;
 
     const uint64_t id = bufferManager.newPage();
@@ -113,7 +114,7 @@ TEST(BufferManager, StoreMultithreadedSamePage) {
 // --------------------------------------------------------------------------
 TEST(BufferManager, StoreMultipleMultithreaded) {
     setup();
-    BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager(FILENAME);
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
     std::vector<std::thread> threads;
 
     for (size_t i = 0; i < 2500; i++) {
@@ -138,8 +139,7 @@ TEST(BufferManager, StoreMultipleMultithreaded) {
                     EXPECT_EQ(page->frame.content[0], random);
                     bufferManager.unpinPage(id, false);
                 }
-                while (!bufferManager.deletePage(id))
-                    ;
+                bufferManager.deletePage(id);
                 break;
             }
         });
@@ -153,7 +153,7 @@ TEST(BufferManager, StoreMultipleMultithreaded) {
 TEST(BufferManager, CheckSize_1) {
     setup();
     {
-        BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager(FILENAME);
+        BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
         std::vector<std::thread> threads;
         for (size_t i = 0; i < 1000; i++) {
             threads.emplace_back([&bufferManager, i]() {
@@ -183,12 +183,12 @@ TEST(BufferManager, CheckSize_1) {
         // the destructor of the buffer manager writes all pages to memory
     }
     EXPECT_EQ(std::filesystem::file_size(FILENAME),
-              sizeof(disk::Header) + 1000 * sizeof(disk::Frame<PAGE_SIZE>));
+              1000 * disk::DiskManager<PAGE_SIZE>::SLOT_SIZE);
 }
 // --------------------------------------------------------------------------
 TEST(BufferManager, CheckSize_2) {
     setup();
-    BufferManager<PAGE_AMOUNT, PAGE_SIZE> bufferManager(FILENAME);
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
     {
         std::unordered_set<uint64_t> ids;
         // fill the buffer
@@ -213,5 +213,615 @@ TEST(BufferManager, CheckSize_2) {
     }
     // total size should be PAGE_AMOUNT + 1 because all pages except the first one were deleted and thus reused
     EXPECT_EQ(std::filesystem::file_size(FILENAME),
-              sizeof(disk::Header) + (PAGE_AMOUNT + 1) * sizeof(disk::Frame<PAGE_SIZE>));
-}
\ No newline at end of file
+              (PAGE_AMOUNT + 1) * disk::DiskManager<PAGE_SIZE>::SLOT_SIZE);
+}// --------------------------------------------------------------------------
+TEST(BufferManager, DeletePinnedPage) {
+    setup();
+    BufferManager<64> bufferManager(FILENAME, 8);
+    const uint64_t id = bufferManager.newPage();
+    auto* page = bufferManager.pinPage(id);
+    ASSERT_NE(page, nullptr);
+    page->frame.content[0] = 42;
+    // doesn't wait for the pin; late readers still find the last content
+    bufferManager.deletePage(id);
+    EXPECT_TRUE(page->deleted);
+    EXPECT_EQ(bufferManager.pinPage(id), page);
+    EXPECT_EQ(page->frame.content[0], 42);
+    bufferManager.unpinPage(id, false);
+    bufferManager.unpinPage(id, true);
+    // the frame is reclaimed once it is unpinned
+    std::vector<Page<64>*> pages;
+    for (size_t i = 0; i < 8; i++) {
+        auto* newPage = bufferManager.pinPage(bufferManager.newPage());
+        ASSERT_NE(newPage, nullptr);
+        EXPECT_FALSE(newPage->deleted);
+        pages.push_back(newPage);
+    }
+    for (auto* p : pages) {
+        bufferManager.unpinPage(*p, false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, PinWhileEvicting) {
+    setup();
+    // much more pages than frames; hits and evictions interleave
+    BufferManager<64> bufferManager(FILENAME, 8);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 64; i++) {
+        const uint64_t id = bufferManager.newPage();
+        auto* page = bufferManager.pinPage(id);
+        ASSERT_NE(page, nullptr);
+        page->frame.content[0] = id % 100;
+        bufferManager.unpinPage(id, true);
+        ids.push_back(id);
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([&bufferManager, &ids, t]() {
+            for (size_t i = 0; i < 20000; i++) {
+                // the first pages are hot
+                const uint64_t id = ids[(i * (t + 1)) % (i % 2 ? 4 : ids.size())];
+                Page<64>* page;
+                while (!(page = bufferManager.pinPage(id)))
+                    ;
+                EXPECT_EQ(page->id, id);
+                EXPECT_EQ(page->frame.content[0], id % 100);
+                bufferManager.unpinPage(id, false);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, PinWaitsForFrame) {
+    setup();
+    BufferManager<64> bufferManager(FILENAME, 4);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 5; i++) {
+        ids.push_back(bufferManager.newPage());
+    }
+    // pin all frames
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_NE(bufferManager.pinPage(ids[i]), nullptr);
+    }
+    // the miss sleeps until a frame is unpinned
+    std::atomic<bool> unpinned = false;
+    std::thread thread([&bufferManager, &ids, &unpinned]() {
+        auto* page = bufferManager.pinPage(ids[4]);
+        ASSERT_NE(page, nullptr);
+        EXPECT_TRUE(unpinned);
+        EXPECT_EQ(page->id, ids[4]);
+        bufferManager.unpinPage(ids[4], false);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    unpinned = true;
+    bufferManager.unpinPage(ids[0], false);
+    thread.join();
+    for (size_t i = 1; i < 4; i++) {
+        bufferManager.unpinPage(ids[i], false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, PinTimeout) {
+    setup();
+    BufferManager<64> bufferManager(FILENAME, 4);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 5; i++) {
+        ids.push_back(bufferManager.newPage());
+    }
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_NE(bufferManager.pinPage(ids[i]), nullptr);
+    }
+    bufferManager.pinTimeout = std::chrono::milliseconds(20);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(bufferManager.pinPage(ids[4]), nullptr);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    // no timeout fails immediately
+    bufferManager.pinTimeout = std::chrono::milliseconds(0);
+    EXPECT_EQ(bufferManager.pinPage(ids[4]), nullptr);
+    for (size_t i = 0; i < 4; i++) {
+        bufferManager.unpinPage(ids[i], false);
+    }
+    EXPECT_NE(bufferManager.pinPage(ids[4]), nullptr);
+    bufferManager.unpinPage(ids[4], false);
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, BackgroundWriter) {
+    setup();
+    std::vector<uint64_t> ids;
+    {
+        BufferManager<64> bufferManager(FILENAME, 4);
+        for (size_t i = 0; i < 5; i++) {
+            ids.push_back(bufferManager.newPage());
+        }
+        for (size_t i = 0; i < 4; i++) {
+            auto* page = bufferManager.pinPage(ids[i]);
+            ASSERT_NE(page, nullptr);
+            page->frame.content[0] = i + 1;
+            bufferManager.unpinPage(ids[i], true);
+        }
+        // the miss clears all reference bits and evicts the first page; the
+        // following ones are written back in the background
+        ASSERT_NE(bufferManager.pinPage(ids[4]), nullptr);
+        bufferManager.unpinPage(ids[4], false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        for (size_t i = 1; i < 3; i++) {
+            auto* page = bufferManager.pinPage(ids[i]);
+            ASSERT_NE(page, nullptr);
+            EXPECT_FALSE(page->modified);
+            EXPECT_EQ(page->frame.content[0], i + 1);
+            bufferManager.unpinPage(ids[i], false);
+        }
+        // destructor
+    }
+    BufferManager<64> bufferManager(FILENAME, 4);
+    for (size_t i = 0; i < 4; i++) {
+        auto* page = bufferManager.pinPage(ids[i]);
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(page->frame.content[0], i + 1);
+        bufferManager.unpinPage(ids[i], false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, BackgroundWriterWatermark) {
+    setup();
+    // (the clock doesn't offer referenced pages)
+    BufferManager<64> bufferManager(FILENAME, 4, nullptr, nullptr, nullptr, {}, Replacement::LFU);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 4; i++) {
+        ids.push_back(bufferManager.newPage());
+    }
+    // no clean frame is left; the writer flushes without a miss
+    for (size_t i = 0; i < 4; i++) {
+        ASSERT_NE(bufferManager.pinPage(ids[i]), nullptr);
+        bufferManager.unpinPage(ids[i], true);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    size_t clean = 0;
+    for (size_t i = 0; i < 4; i++) {
+        auto* page = bufferManager.pinPage(ids[i]);
+        ASSERT_NE(page, nullptr);
+        clean += !page->modified;
+        bufferManager.unpinPage(ids[i], false);
+    }
+    EXPECT_GT(clean, 0);
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, NoBackgroundWriter) {
+    setup();
+    BufferManager<64> bufferManager(FILENAME, 4, nullptr, nullptr, nullptr, {}, Replacement::Clock, nullptr,
+                                    {.backgroundWriter = false});
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 5; i++) {
+        ids.push_back(bufferManager.newPage());
+    }
+    for (size_t i = 0; i < 4; i++) {
+        auto* page = bufferManager.pinPage(ids[i]);
+        ASSERT_NE(page, nullptr);
+        page->frame.content[0] = i + 1;
+        bufferManager.unpinPage(ids[i], true);
+    }
+    ASSERT_NE(bufferManager.pinPage(ids[4]), nullptr);
+    bufferManager.unpinPage(ids[4], false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // only the miss wrote a page
+    for (size_t i = 1; i < 4; i++) {
+        auto* page = bufferManager.pinPage(ids[i]);
+        ASSERT_NE(page, nullptr);
+        EXPECT_TRUE(page->modified);
+        bufferManager.unpinPage(ids[i], false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, PreallocatedFrames) {
+    setup();
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
+    std::vector<Page<PAGE_SIZE>*> pages;
+    for (size_t i = 0; i < 2 * PAGE_AMOUNT; i++) {
+        uint64_t id = bufferManager.newPage();
+        auto* page = bufferManager.pinPage(id);
+        ASSERT_NE(page, nullptr);
+        page->frame.content[0] = static_cast<char>(id % 100);
+        if (i < PAGE_AMOUNT) {
+            pages.push_back(page);
+        }
+        bufferManager.unpinPage(id, true);
+    }
+    // all pages are in one contiguous range; the frames can be used for
+    // direct I/O as they are
+    auto* begin = *std::min_element(pages.begin(), pages.end());
+    auto* end = *std::max_element(pages.begin(), pages.end());
+    EXPECT_EQ(end - begin, PAGE_AMOUNT - 1);
+    for (auto* page : pages) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(page->frame.content.data()) % disk::DIRECT_IO_ALIGNMENT, 0);
+    }
+    // evicted pages are read back into the reused frames
+    for (size_t id = 0; id < 2 * PAGE_AMOUNT; id++) {
+        auto* page = bufferManager.pinPage(id);
+        ASSERT_NE(page, nullptr);
+        EXPECT_GE(page, begin);
+        EXPECT_LE(page, end);
+        EXPECT_EQ(page->frame.content[0], id % 100);
+        bufferManager.unpinPage(id, false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, ConcurrentMisses) {
+    setup();
+    // far more pages than frames; modified pages are written back by misses
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, 8);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 64; i++) {
+        ids.push_back(bufferManager.newPage());
+        auto* page = bufferManager.pinPage(ids.back());
+        ASSERT_NE(page, nullptr);
+        page->frame.content[0] = static_cast<char>(ids.back() % 100);
+        bufferManager.unpinPage(ids.back(), true);
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 8; t++) {
+        threads.emplace_back([&bufferManager, &ids, t]() {
+            for (size_t i = 0; i < 2000; i++) {
+                // every page is requested by several threads at once
+                const uint64_t id = ids[(i + t % 2) % ids.size()];
+                auto* page = bufferManager.pinPage(id);
+                if (!page) {
+                    continue;
+                }
+                // the frame holds the page it was loaded for
+                EXPECT_EQ(page->id, id);
+                page->mutex.lock();
+                EXPECT_EQ(page->frame.content[0], id % 100);
+                page->frame.content[1]++;
+                page->mutex.unlock();
+                bufferManager.unpinPage(*page, true);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (uint64_t id : ids) {
+        auto* page = bufferManager.pinPage(id);
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(page->frame.content[0], id % 100);
+        bufferManager.unpinPage(id, false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, Prefetch) {
+    setup();
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, 64, nullptr, nullptr, nullptr, {disk::IOMode::IoUring});
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < 200; i++) {
+        ids.push_back(bufferManager.newPage());
+        auto* page = bufferManager.pinPage(ids.back());
+        page->frame.content[0] = static_cast<char>(ids.back() % 100);
+        bufferManager.unpinPage(*page, true);
+    }
+    // the first pages were evicted (and written back); a quarter of the
+    // buffer is loaded, unpinned
+    std::vector<uint64_t> prefetched(ids.begin(), ids.begin() + 32);
+    bufferManager.prefetch(prefetched);
+    size_t resident = 0;
+    for (uint64_t id : prefetched) {
+        if (auto* page = bufferManager.findPage(id)) {
+            EXPECT_EQ(page->pinned, 0);
+            resident++;
+        }
+    }
+    EXPECT_EQ(resident, 16);
+    for (uint64_t id : ids) {
+        auto* page = bufferManager.pinPage(id);
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(page->frame.content[0], id % 100);
+        bufferManager.unpinPage(*page, false);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, Resize) {
+    setup();
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, PAGE_AMOUNT);
+    std::vector<uint64_t> ids;
+    for (size_t i = 0; i < PAGE_AMOUNT; i++) {
+        ids.push_back(bufferManager.newPage());
+        auto* page = bufferManager.pinPage(ids.back());
+        ASSERT_NE(page, nullptr);
+        page->frame.content[0] = static_cast<char>(ids.back() % 100);
+        bufferManager.unpinPage(ids.back(), true);
+    }
+    // the last page is in a removed frame; shrinking waits until it is unpinned
+    auto* pinned = bufferManager.pinPage(ids.back());
+    ASSERT_NE(pinned, nullptr);
+    std::thread unpinner([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        bufferManager.unpinPage(ids.back(), false);
+    });
+    bufferManager.resize(100);
+    unpinner.join();
+    EXPECT_EQ(bufferManager.bufferFrames(), 100);
+    // only 100 pages can be pinned at once
+    std::vector<Page<PAGE_SIZE>*> pages;
+    bufferManager.pinTimeout = std::chrono::milliseconds(0);
+    for (uint64_t id : ids) {
+        auto* page = bufferManager.pinPage(id);
+        if (!page) {
+            break;
+        }
+        EXPECT_EQ(page->frame.content[0], id % 100);
+        pages.push_back(page);
+    }
+    EXPECT_EQ(pages.size(), 100);
+    for (auto* page : pages) {
+        bufferManager.unpinPage(*page, false);
+    }
+    // grow again
+    bufferManager.resize(300);
+    pages.clear();
+    for (uint64_t id : ids) {
+        auto* page = bufferManager.pinPage(id);
+        if (!page) {
+            break;
+        }
+        EXPECT_EQ(page->frame.content[0], id % 100);
+        pages.push_back(page);
+    }
+    EXPECT_EQ(pages.size(), 300);
+    for (auto* page : pages) {
+        bufferManager.unpinPage(*page, false);
+    }
+    bufferManager.setMemoryBudget(50 * sizeof(Page<PAGE_SIZE>));
+    EXPECT_EQ(bufferManager.bufferFrames(), 50);
+    EXPECT_ANY_THROW(bufferManager.resize(0));
+    // only the initial amount of frames is reserved by default
+    EXPECT_ANY_THROW(bufferManager.resize(PAGE_AMOUNT + 1));
+    bufferManager.resize(PAGE_AMOUNT);
+    EXPECT_EQ(bufferManager.bufferFrames(), PAGE_AMOUNT);
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, MaxFrames) {
+    setup();
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, 100, nullptr, nullptr, nullptr, {}, Replacement::Clock, nullptr,
+                                           {.maxFrames = 400});
+    bufferManager.resize(400);
+    EXPECT_EQ(bufferManager.bufferFrames(), 400);
+    EXPECT_ANY_THROW(bufferManager.resize(401));
+    EXPECT_ANY_THROW(BufferManager<PAGE_SIZE>(FILENAME, 100, nullptr, nullptr, nullptr, {}, Replacement::Clock,
+                                              nullptr, {.maxFrames = 50}));
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, ReplacementPolicies) {
+    for (const Replacement replacement :
+         {Replacement::Clock, Replacement::TwoQ, Replacement::LRUK, Replacement::LFU, Replacement::Cooling}) {
+        setup();
+        BufferManager<PAGE_SIZE> bufferManager(FILENAME, 64, nullptr, nullptr, nullptr, {}, replacement);
+        std::vector<uint64_t> ids;
+        for (size_t i = 0; i < 512; i++) {
+            ids.push_back(bufferManager.newPage());
+        }
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 8; t++) {
+            threads.emplace_back([&bufferManager, &ids, t]() {
+                // every thread modifies its own pages and reads all of them
+                for (size_t i = 0; i < 4000; i++) {
+                    const uint64_t id = ids[rand() % ids.size()];
+                    const bool own = id % 8 == t;
+                    auto* page = bufferManager.pinPage(id);
+                    if (!page) {
+                        continue;
+                    }
+                    if (own) {
+                        page->frame.content[1] = static_cast<char>(page->frame.content[1] + 1);
+                    }
+                    bufferManager.unpinPage(id, own);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        // the content survives evictions
+        for (uint64_t id : ids) {
+            auto* page = bufferManager.pinPage(id);
+            ASSERT_NE(page, nullptr);
+            page->frame.content[0] = static_cast<char>(id % 100);
+            bufferManager.unpinPage(id, true);
+        }
+        for (uint64_t id : ids) {
+            auto* page = bufferManager.pinPage(id);
+            ASSERT_NE(page, nullptr);
+            EXPECT_EQ(page->frame.content[0], id % 100);
+            bufferManager.unpinPage(id, false);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, ScanResistance) {
+    for (const Replacement replacement : {Replacement::TwoQ, Replacement::LRUK, Replacement::LFU}) {
+        SCOPED_TRACE(static_cast<int>(replacement));
+        setup();
+        BufferManager<PAGE_SIZE> bufferManager(FILENAME, 64, nullptr, nullptr, nullptr, {}, replacement);
+        std::vector<uint64_t> hot;
+        std::vector<uint64_t> cold;
+        for (size_t i = 0; i < 16; i++) {
+            hot.push_back(bufferManager.newPage());
+        }
+        for (size_t i = 0; i < 512; i++) {
+            cold.push_back(bufferManager.newPage());
+        }
+        const auto access = [&bufferManager](uint64_t id) {
+            auto* page = bufferManager.pinPage(id);
+            ASSERT_NE(page, nullptr);
+            bufferManager.unpinPage(id, false);
+        };
+        // the hot pages are accessed repeatedly, in between some cold ones
+        for (size_t round = 0; round < 8; round++) {
+            for (uint64_t id : hot) {
+                access(id);
+            }
+            for (size_t i = 0; i < 64; i++) {
+                access(cold[(round * 64 + i) % cold.size()]);
+            }
+        }
+        // changes which aren't marked as modified are lost on eviction
+        for (uint64_t id : hot) {
+            auto* page = bufferManager.pinPage(id);
+            ASSERT_NE(page, nullptr);
+            page->frame.content[0] = 1;
+            bufferManager.unpinPage(id, false);
+        }
+        // one scan over all cold pages must not evict the hot ones
+        for (uint64_t id : cold) {
+            access(id);
+        }
+        for (uint64_t id : hot) {
+            auto* page = bufferManager.pinPage(id);
+            ASSERT_NE(page, nullptr);
+            EXPECT_EQ(page->frame.content[0], 1);
+            bufferManager.unpinPage(id, false);
+        }
+    }
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, CoolingStage) {
+    setup();
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, 64, nullptr, nullptr, nullptr, {}, Replacement::Cooling);
+    const uint64_t hotID = bufferManager.newPage();
+    std::vector<uint64_t> cold;
+    for (size_t i = 0; i < 512; i++) {
+        cold.push_back(bufferManager.newPage());
+    }
+    const auto scan = [&bufferManager, &cold]() {
+        for (uint64_t id : cold) {
+            ASSERT_NE(bufferManager.pinPage(id), nullptr);
+            bufferManager.unpinPage(id, false);
+        }
+    };
+    // pages are cooling from now on
+    scan();
+    // changes which aren't marked as modified are lost on eviction
+    auto* hot = bufferManager.pinPage(hotID);
+    ASSERT_NE(hot, nullptr);
+    hot->frame.content[0] = 1;
+    bufferManager.unpinPage(hotID, false);
+    for (size_t round = 0; round < 4; round++) {
+        for (uint64_t id : cold) {
+            ASSERT_NE(bufferManager.pinPage(id), nullptr);
+            bufferManager.unpinPage(id, false);
+            // the hot page is accessed before it leaves the cooling stage
+            hot = bufferManager.pinPage(hotID);
+            ASSERT_NE(hot, nullptr);
+            EXPECT_EQ(hot->frame.content[0], 1);
+            bufferManager.unpinPage(hotID, false);
+        }
+    }
+    // without accesses, it is evicted eventually
+    scan();
+    hot = bufferManager.pinPage(hotID);
+    ASSERT_NE(hot, nullptr);
+    EXPECT_EQ(hot->frame.content[0], 0);
+    bufferManager.unpinPage(hotID, false);
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, ProtectInnerNodes) {
+    setup();
+    // inner nodes are marked by their first byte and store the ids of their
+    // children behind it
+    constexpr size_t CHILDREN = 4;
+    const auto isInnerNode = [](Page<PAGE_SIZE>* page) { return page->frame.content[0] == 1; };
+    const auto residentChildren = [isInnerNode](Page<PAGE_SIZE>* page, const PageTable& loadedPages) {
+        if (!isInnerNode(page)) {
+            return false;
+        }
+        for (size_t i = 0; i < CHILDREN; i++) {
+            uint64_t child;
+            std::memcpy(&child, page->frame.content.data() + 8 + i * 8, sizeof(child));
+            if (loadedPages.contains(child)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    BufferManager<PAGE_SIZE> bufferManager(FILENAME, 64, nullptr, isInnerNode, nullptr, {}, Replacement::Clock,
+                                           residentChildren);
+    bufferManager.protectInnerNodes = true;
+    const uint64_t parentID = bufferManager.newPage();
+    std::vector<uint64_t> children;
+    for (size_t i = 0; i < CHILDREN; i++) {
+        children.push_back(bufferManager.newPage());
+    }
+    std::vector<uint64_t> cold;
+    for (size_t i = 0; i < 512; i++) {
+        cold.push_back(bufferManager.newPage());
+    }
+    auto* parent = bufferManager.pinPage(parentID);
+    ASSERT_NE(parent, nullptr);
+    parent->frame.content[0] = 1;
+    std::memcpy(parent->frame.content.data() + 8, children.data(), CHILDREN * sizeof(uint64_t));
+    bufferManager.unpinPage(parentID, true);
+    const auto scan = [&bufferManager, &cold]() {
+        for (uint64_t id : cold) {
+            ASSERT_NE(bufferManager.pinPage(id), nullptr);
+            bufferManager.unpinPage(id, false);
+        }
+    };
+    // evict the parent, so that it is loaded as an inner node
+    scan();
+    parent = bufferManager.pinPage(parentID, true);
+    ASSERT_NE(parent, nullptr);
+    // changes which aren't marked as modified are lost on eviction
+    parent->frame.content[1] = 1;
+    bufferManager.unpinPage(parentID, false);
+    // the children stay in memory
+    for (uint64_t id : children) {
+        ASSERT_NE(bufferManager.pinPage(id), nullptr);
+    }
+    scan();
+    parent = bufferManager.pinPage(parentID, true);
+    ASSERT_NE(parent, nullptr);
+    EXPECT_EQ(parent->frame.content[1], 1);
+    bufferManager.unpinPage(parentID, false);
+    // leaves are evicted first
+    for (uint64_t id : children) {
+        bufferManager.unpinPage(id, false);
+    }
+    scan();
+    parent = bufferManager.pinPage(parentID, true);
+    ASSERT_NE(parent, nullptr);
+    EXPECT_EQ(parent->frame.content[1], 1);
+    bufferManager.unpinPage(parentID, false);
+}
+// --------------------------------------------------------------------------
+TEST(BufferManager, OnlyInnerNodes) {
+    for (const Replacement replacement :
+         {Replacement::Clock, Replacement::TwoQ, Replacement::LRUK, Replacement::LFU, Replacement::Cooling}) {
+        SCOPED_TRACE(static_cast<int>(replacement));
+        setup();
+        const auto isInnerNode = [](Page<PAGE_SIZE>*) { return true; };
+        const auto residentChildren = [](Page<PAGE_SIZE>*, const PageTable&) { return false; };
+        BufferManager<PAGE_SIZE> bufferManager(FILENAME, 3, nullptr, isInnerNode, nullptr, {}, replacement,
+                                               residentChildren);
+        bufferManager.protectInnerNodes = true;
+        std::vector<uint64_t> ids;
+        for (size_t i = 0; i < 8; i++) {
+            ids.push_back(bufferManager.newPage());
+        }
+        for (size_t round = 0; round < 4; round++) {
+            for (size_t i = 0; i < ids.size(); i++) {
+                auto* page = bufferManager.pinPage(ids[i], true);
+                ASSERT_NE(page, nullptr);
+                page->frame.content[0] = static_cast<char>(i);
+                bufferManager.unpinPage(ids[i], true);
+            }
+        }
+        // inner nodes are evicted when there is nothing else
+        for (size_t i = 0; i < ids.size(); i++) {
+            auto* page = bufferManager.pinPage(ids[i], true);
+            ASSERT_NE(page, nullptr);
+            EXPECT_EQ(page->frame.content[0], static_cast<char>(i));
+            bufferManager.unpinPage(ids[i], false);
+        }
+    }
+}
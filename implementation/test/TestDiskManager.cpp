@@ -55,7 +55,7 @@ TEST(DiskManager, DeleteData) {
         }
     }
     EXPECT_EQ(std::filesystem::file_size(FILENAME),
-              sizeof(Header) + 500 * sizeof(Frame<BLOCK_SIZE>));
+              500 * DiskManager<BLOCK_SIZE>::SLOT_SIZE);
 }
 // --------------------------------------------------------------------------
 TEST(DiskManager, RestoreData) {
@@ -77,7 +77,7 @@ TEST(DiskManager, RestoreData) {
             }
         }
         EXPECT_EQ(std::filesystem::file_size(FILENAME),
-                  sizeof(Header) + 500 * sizeof(Frame<BLOCK_SIZE>));
+                  500 * DiskManager<BLOCK_SIZE>::SLOT_SIZE);
     }
     // reopen file
     DiskManager<BLOCK_SIZE> manager(FILENAME);
@@ -88,7 +88,7 @@ TEST(DiskManager, RestoreData) {
         }
     }
     EXPECT_EQ(std::filesystem::file_size(FILENAME),
-              sizeof(Header) + 500 * sizeof(Frame<BLOCK_SIZE>));
+              500 * DiskManager<BLOCK_SIZE>::SLOT_SIZE);
 }
 // --------------------------------------------------------------------------
 TEST(DiskManager, DeleteAllData) {
@@ -105,7 +105,82 @@ TEST(DiskManager, DeleteAllData) {
     auto p = manager.createPage();
     EXPECT_EQ(p.first, 0);
     EXPECT_EQ(std::filesystem::file_size(FILENAME),
-              sizeof(Header) + 1000 * sizeof(Frame<BLOCK_SIZE>));
+              1000 * DiskManager<BLOCK_SIZE>::SLOT_SIZE);
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, RestoreAllocationBitmap) {
+    setup();
+    {
+        DiskManager<BLOCK_SIZE> manager(FILENAME);
+        for (size_t i = 0; i < 1000; i++) {
+            manager.createPage();
+        }
+        for (size_t i = 0; i < 1000; i += 2) {
+            manager.deletePage(i);
+        }
+        // deleting twice is ignored
+        manager.deletePage(0);
+        EXPECT_EQ(manager.entryAmount(), 500);
+    }
+    // header and bitmap only
+    EXPECT_EQ(std::filesystem::file_size(FILENAME + ".meta"), sizeof(Header) + 1000 / 64 * 8 + 8);
+    DiskManager<BLOCK_SIZE> manager(FILENAME);
+    EXPECT_EQ(manager.entryAmount(), 500);
+    // the free frames are reused in ascending order
+    for (size_t i = 0; i < 1000; i += 2) {
+        EXPECT_EQ(manager.createPage().first, i);
+    }
+    EXPECT_EQ(manager.createPage().first, 1000);
+    EXPECT_EQ(manager.entryAmount(), 1001);
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, DeferredMetadata) {
+    setup();
+    IOConfig config;
+    config.metadataBatch = 0;
+    DiskManager<BLOCK_SIZE> manager(FILENAME, config);
+    for (size_t i = 0; i < 1000; i++) {
+        manager.createPage();
+    }
+    // nothing but the header written on open
+    EXPECT_EQ(std::filesystem::file_size(FILENAME + ".meta"), sizeof(Header));
+    manager.checkpoint();
+    EXPECT_EQ(std::filesystem::file_size(FILENAME + ".meta"), sizeof(Header) + 1000 / 64 * 8 + 8);
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, RecoverHeader) {
+    setup();
+    const string copy = "/tmp/crashed.txt";
+    IOConfig config;
+    config.metadataBatch = 0;
+    {
+        DiskManager<BLOCK_SIZE> manager(FILENAME, config);
+        for (size_t i = 0; i < 100; i++) {
+            manager.createPage();
+        }
+        manager.deletePage(10);
+        manager.checkpoint();
+        for (size_t i = 0; i < 50; i++) {
+            manager.createPage();
+        }
+        manager.deletePage(20);
+        // the state of a crash: the last changes are only in memory
+        std::filesystem::copy_file(FILENAME, copy, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::copy_file(FILENAME + ".meta", copy + ".meta",
+                                   std::filesystem::copy_options::overwrite_existing);
+    }
+    {
+        DiskManager<BLOCK_SIZE> manager(copy, config);
+        // the reused frame and those beyond the header are kept, the last
+        // deletion is lost
+        EXPECT_EQ(manager.entryAmount(), 149);
+        EXPECT_EQ(manager.createPage().first, 149);
+    }
+    // closed properly
+    DiskManager<BLOCK_SIZE> manager(copy, config);
+    EXPECT_EQ(manager.entryAmount(), 150);
+    std::filesystem::remove(copy);
+    std::filesystem::remove(copy + ".meta");
 }
 // --------------------------------------------------------------------------
 TEST(DiskManager, MultiThreadedAccess) {
@@ -131,4 +206,158 @@ TEST(DiskManager, MultiThreadedAccess) {
     for (auto& t : threads) {
         t.join();
     }
-}
\ No newline at end of file
+}// --------------------------------------------------------------------------
+TEST(DiskManager, IoUring) {
+    setup();
+    {
+        DiskManager<BLOCK_SIZE> manager(FILENAME, {IOMode::IoUring});
+        for (size_t i = 0; i < 1000; i++) {
+            auto p = manager.createPage();
+            std::memset(p.second.content.data(), static_cast<char>(p.first % 100), BLOCK_SIZE);
+            manager.writePage(p.first, std::move(p.second));
+            if (i % 2 == 0) {
+                manager.deletePage(p.first);
+            }
+        }
+        // reuses the deleted frames; one batch
+        std::vector<Frame<BLOCK_SIZE>> frames(500);
+        std::vector<std::pair<uint64_t, const Frame<BLOCK_SIZE>*>> writes;
+        for (size_t i = 0; i < 500; i++) {
+            auto p = manager.createPage();
+            std::memset(frames[i].content.data(), static_cast<char>(p.first % 100), BLOCK_SIZE);
+            writes.emplace_back(p.first, &frames[i]);
+        }
+        manager.writePages(writes);
+        EXPECT_EQ(manager.entryAmount(), 1000);
+    }
+    // the file format doesn't depend on the mode
+    DiskManager<BLOCK_SIZE> manager(FILENAME);
+    for (size_t i = 0; i < 1000; i++) {
+        Frame<BLOCK_SIZE> frame = manager.retrievePage(i);
+        for (char c : frame.content) {
+            EXPECT_EQ(c, i % 100);
+        }
+    }
+    EXPECT_EQ(std::filesystem::file_size(FILENAME),
+              1000 * DiskManager<BLOCK_SIZE>::SLOT_SIZE);
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, IoUringMultiThreaded) {
+    setup();
+    DiskManager<BLOCK_SIZE> manager(FILENAME, {IOMode::IoUring});
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 16; i++) {
+        threads.emplace_back([&manager]() {
+            for (size_t i = 0; i < 500; i++) {
+                auto p = manager.createPage();
+                std::memset(p.second.content.data(), static_cast<char>(p.first % 100), BLOCK_SIZE);
+                manager.writePage(p.first, std::move(p.second));
+                auto frame = manager.retrievePage(p.first);
+                for (char c : frame.content) {
+                    EXPECT_EQ(c, p.first % 100);
+                }
+                manager.deletePage(p.first);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(manager.entryAmount(), 0);
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, IoUringSubmitAndPoll) {
+    setup();
+    {
+        DiskManager<BLOCK_SIZE> manager(FILENAME);
+        for (size_t i = 0; i < 600; i++) {
+            auto p = manager.createPage();
+            std::memset(p.second.content.data(), static_cast<char>(p.first % 100), BLOCK_SIZE);
+            manager.writePage(p.first, p.second);
+        }
+    }
+    int fd = open(FILENAME.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    {
+        // more requests than the ring has entries; submitting doesn't wait
+        IoUring ring(64);
+        std::vector<Frame<BLOCK_SIZE>> frames(600);
+        std::vector<IORequest> requests;
+        for (size_t i = 0; i < frames.size(); i++) {
+            requests.push_back({fd, false, frames[i].content.data(), BLOCK_SIZE, i * BLOCK_SIZE});
+        }
+        ring.submit(requests);
+        ring.wait(ring.pending() / 2);
+        ring.poll();
+        ring.wait();
+        EXPECT_EQ(ring.pending(), 0);
+        for (size_t i = 0; i < frames.size(); i++) {
+            EXPECT_EQ(requests[i].result, BLOCK_SIZE);
+            EXPECT_EQ(frames[i].content[BLOCK_SIZE - 1], i % 100);
+        }
+    }
+    close(fd);
+    // the disk manager reads in one batch
+    DiskManager<BLOCK_SIZE> manager(FILENAME, {IOMode::IoUring});
+    std::vector<Frame<BLOCK_SIZE>> frames(300);
+    std::vector<std::pair<uint64_t, Frame<BLOCK_SIZE>*>> reads;
+    for (size_t i = 0; i < frames.size(); i++) {
+        reads.emplace_back(2 * i, &frames[i]);
+    }
+    manager.readPages(reads);
+    for (size_t i = 0; i < frames.size(); i++) {
+        EXPECT_EQ(frames[i].content[0], 2 * i % 100);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, DirectIO) {
+    setup();
+    for (IOMode mode : {IOMode::Synchronous, IOMode::IoUring}) {
+        setup();
+        {
+            DiskManager<BLOCK_SIZE> manager(FILENAME, {mode, true});
+            for (size_t i = 0; i < 100; i++) {
+                auto p = manager.createPage();
+                std::memset(p.second.content.data(), static_cast<char>(p.first % 100), BLOCK_SIZE);
+                manager.writePage(p.first, p.second);
+            }
+        }
+        // the file format doesn't depend on the mode
+        DiskManager<BLOCK_SIZE> manager(FILENAME);
+        for (size_t i = 0; i < 100; i++) {
+            Frame<BLOCK_SIZE> frame = manager.retrievePage(i);
+            for (char c : frame.content) {
+                EXPECT_EQ(c, i % 100);
+            }
+        }
+        EXPECT_EQ(std::filesystem::file_size(FILENAME), 100 * BLOCK_SIZE);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(DiskManager, DirectIOUnaligned) {
+    setup();
+    // the frames don't cover whole sectors
+    constexpr size_t SIZE = 1000;
+    static_assert(!Frame<SIZE>::ALIGNED);
+    {
+        DiskManager<SIZE> manager(FILENAME);
+        for (size_t i = 0; i < 50; i++) {
+            auto p = manager.createPage();
+            std::memset(p.second.content.data(), static_cast<char>(p.first % 100), SIZE);
+            manager.writePage(p.first, p.second);
+        }
+    }
+    DiskManager<SIZE> manager(FILENAME, {IOMode::Synchronous, true});
+    for (size_t i = 0; i < 100; i++) {
+        auto p = manager.createPage();
+        std::memset(p.second.content.data(), static_cast<char>(p.first % 100), SIZE);
+        manager.writePage(p.first, p.second);
+    }
+    for (size_t i = 0; i < 150; i++) {
+        Frame<SIZE> frame = manager.retrievePage(i);
+        for (char c : frame.content) {
+            EXPECT_EQ(c, i % 100);
+        }
+    }
+    EXPECT_EQ(std::filesystem::file_size(FILENAME), 150 * DiskManager<SIZE>::SLOT_SIZE);
+}
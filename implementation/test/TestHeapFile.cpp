@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+// --------------------------------------------------------------------------
+#include "src/heap/HeapFile.h"
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+// --------------------------------------------------------------------------
+using namespace std;
+using namespace heap;
+// --------------------------------------------------------------------------
+namespace {
+// --------------------------------------------------------------------------
+static const string FILENAME = "/tmp/heap.txt";
+constexpr size_t PAGE_AMOUNT = 50;
+constexpr size_t PAGE_SIZE = 4096;
+void setup() {
+    std::remove(FILENAME.c_str());
+}
+// --------------------------------------------------------------------------
+string readRecord(HeapFile<PAGE_SIZE>& heapFile, uint64_t tid) {
+    string record;
+    heapFile.read(tid, [&record](string_view bytes) {
+        record = bytes;
+    });
+    return record;
+}
+// --------------------------------------------------------------------------
+string makeRecord(size_t i) {
+    // variable length, including empty records
+    return string(i % 300, 'a' + i % 26);
+}
+// --------------------------------------------------------------------------
+} // namespace
+// --------------------------------------------------------------------------
+TEST(SlottedPage, InsertUpdateErase) {
+    auto page = std::make_unique<SlottedPage<PAGE_SIZE>>();
+    vector<uint16_t> slots;
+    while (auto slot = page->insert(string(100, 'x'))) {
+        slots.push_back(*slot);
+    }
+    EXPECT_EQ(slots.size(), (PAGE_SIZE - 8) / 104);
+    EXPECT_FALSE(page->insert(string(100, 'x')));
+    // erased space is reused after compaction
+    page->erase(slots[3]);
+    page->erase(slots[5]);
+    EXPECT_TRUE(page->update(slots[4], string(250, 'y')));
+    EXPECT_EQ(page->read(slots[4]), string(250, 'y'));
+    EXPECT_FALSE(page->update(slots[4], string(400, 'y')));
+    auto slot = page->insert(string(10, 'z'));
+    ASSERT_TRUE(slot);
+    EXPECT_EQ(*slot, slots[3]);
+    EXPECT_EQ(page->read(*slot), string(10, 'z'));
+    for (uint16_t s : slots) {
+        if (s != slots[3] && s != slots[4] && s != slots[5]) {
+            EXPECT_EQ(page->read(s), string(100, 'x'));
+        }
+    }
+    for (uint16_t s : slots) {
+        if (s != slots[5]) {
+            page->erase(s);
+        }
+    }
+    EXPECT_TRUE(page->empty());
+    EXPECT_TRUE(page->insert(string(SlottedPage<PAGE_SIZE>::MAX_RECORD_SIZE, 'm')));
+}
+// --------------------------------------------------------------------------
+TEST(HeapFile, StoreData) {
+    setup();
+    unordered_map<uint64_t, string> records;
+    {
+        HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+        for (size_t i = 0; i < 5000; i++) {
+            const string record = makeRecord(i);
+            records[heapFile.insert(record)] = record;
+        }
+        EXPECT_EQ(records.size(), 5000);
+        // more pages than frames
+        EXPECT_GT(heapFile.pageAmount(), PAGE_AMOUNT);
+        for (const auto& [tid, record] : records) {
+            EXPECT_EQ(readRecord(heapFile, tid), record);
+        }
+        // destructor
+    }
+    HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+    for (const auto& [tid, record] : records) {
+        EXPECT_EQ(readRecord(heapFile, tid), record);
+    }
+}
+// --------------------------------------------------------------------------
+TEST(HeapFile, UpdateAndErase) {
+    setup();
+    {
+        HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+        unordered_map<uint64_t, string> records;
+        for (size_t i = 0; i < 2000; i++) {
+            const string record = makeRecord(i);
+            records[heapFile.insert(record)] = record;
+        }
+        // grow all records (some of them have to be moved)
+        unordered_map<uint64_t, string> updated;
+        size_t moved = 0;
+        for (const auto& [tid, record] : records) {
+            const string newRecord = record + string(200, '+');
+            const uint64_t newTID = heapFile.update(tid, newRecord);
+            moved += newTID != tid;
+            updated[newTID] = newRecord;
+        }
+        EXPECT_EQ(updated.size(), records.size());
+        EXPECT_GT(moved, 0);
+        const size_t pages = heapFile.pageAmount();
+        for (const auto& [tid, record] : updated) {
+            EXPECT_EQ(readRecord(heapFile, tid), record);
+        }
+        // erasing everything frees the pages (lazily)
+        for (const auto& [tid, record] : updated) {
+            heapFile.erase(tid);
+        }
+        EXPECT_GT(pages, 1);
+    }
+    HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+    EXPECT_EQ(heapFile.pageAmount(), 0);
+}
+// --------------------------------------------------------------------------
+TEST(HeapFile, FreeSpaceReuse) {
+    setup();
+    HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+    vector<uint64_t> tids;
+    for (size_t i = 0; i < 100; i++) {
+        tids.push_back(heapFile.insert(string(200, 'a')));
+    }
+    const size_t pages = heapFile.pageAmount();
+    ASSERT_GT(pages, 2);
+    // every page except the last one keeps a single record
+    unordered_set<uint64_t> sparsePages;
+    for (size_t i = 0; i < tids.size(); i++) {
+        if (getPageID(tids[i]) != getPageID(tids.back()) && (i == 0 || getPageID(tids[i]) != getPageID(tids[i - 1]))) {
+            sparsePages.insert(getPageID(tids[i]));
+            continue;
+        }
+        heapFile.erase(tids[i]);
+    }
+    // the inserts fill the sparse pages instead of allocating new ones
+    unordered_set<uint64_t> used;
+    for (size_t i = 0; i < 50; i++) {
+        used.insert(getPageID(heapFile.insert(string(200, 'b'))));
+    }
+    EXPECT_EQ(heapFile.pageAmount(), pages);
+    for (uint64_t id : used) {
+        EXPECT_TRUE(sparsePages.contains(id) || id == getPageID(tids.back()));
+    }
+}
+// --------------------------------------------------------------------------
+TEST(HeapFile, TooLarge) {
+    setup();
+    HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+    EXPECT_THROW(heapFile.insert(string(PAGE_SIZE, 'x')), std::runtime_error);
+    const uint64_t tid = heapFile.insert("x");
+    EXPECT_THROW(heapFile.update(tid, string(PAGE_SIZE, 'x')), std::runtime_error);
+}
+// --------------------------------------------------------------------------
+TEST(HeapFile, MultiThreaded) {
+    setup();
+    {
+        HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+        vector<thread> threads;
+        for (size_t t = 0; t < 4; t++) {
+            threads.emplace_back([&heapFile, t]() {
+                // every thread only accesses its own records
+                vector<pair<uint64_t, string>> records;
+                for (size_t i = t * 2000; i < (t + 1) * 2000; i++) {
+                    const string record = makeRecord(i);
+                    records.emplace_back(heapFile.insert(record), record);
+                }
+                for (auto& [tid, record] : records) {
+                    record += to_string(tid);
+                    tid = heapFile.update(tid, record);
+                }
+                unordered_set<uint64_t> tids;
+                for (const auto& [tid, record] : records) {
+                    EXPECT_EQ(readRecord(heapFile, tid), record);
+                    tids.insert(tid);
+                }
+                EXPECT_EQ(tids.size(), records.size());
+                for (const auto& [tid, record] : records) {
+                    heapFile.erase(tid);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+    HeapFile<PAGE_SIZE> heapFile(FILENAME, PAGE_AMOUNT);
+    EXPECT_EQ(heapFile.pageAmount(), 0);
+}
+// --------------------------------------------------------------------------
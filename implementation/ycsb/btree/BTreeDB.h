@@ -7,6 +7,7 @@
 #include "src/btree/BTree.h"
 #include <filesystem>
 #include <array>
+#include <string>
 // --------------------------------------------------------------------------
 namespace ycsbc {
 // --------------------------------------------------------------------------
@@ -15,13 +16,13 @@ class BTreeDB : public DB {
 
     public:
     using KEY = std::array<char, 32>;
-    using DATA = std::array<char, 1000>;
+    // records have variable length (the concatenated field values)
+    using DATA = std::string;
 
-    static constexpr size_t PAGES = 75 * 1000;
     static constexpr size_t PAGE_SIZE = 4096;
 
     public:
-    btree::BTree<KEY, DATA, PAGES, PAGE_SIZE>* tree = nullptr;
+    btree::BTree<KEY, DATA, PAGE_SIZE>* tree = nullptr;
 
     public:
     void Init();
@@ -39,8 +40,37 @@ template <bool C, bool X>
 void BTreeDB<C, X>::Init() {
     std::filesystem::remove("/tmp/tree.txt");
     std::filesystem::remove("/tmp/data.txt");
-    tree = new btree::BTree<KEY, DATA, PAGES, PAGE_SIZE>(
-        "/tmp/tree.txt", "/tmp/data.txt", C, X);
+    const bool optimisticReads = props_->GetProperty("btree.optimisticreads", "true") == "true";
+    disk::IOConfig ioConfig;
+    // "sync" or "uring"
+    const std::string io = props_->GetProperty("btree.io", "sync");
+    if (io == "uring") {
+        ioConfig.mode = disk::IOMode::IoUring;
+    }
+    ioConfig.direct = props_->GetProperty("btree.directio", "false") == "true";
+    // 0 defers the allocation metadata to checkpoints
+    ioConfig.metadataBatch = std::stoul(props_->GetProperty("btree.metadatabatch", "64"));
+    // frames of both buffers together (tree and heap)
+    const size_t pages = std::stoul(props_->GetProperty("btree.pages", "150000"));
+    // "clock", "2q", "lruk", "lfu" or "cooling"
+    const std::string replacement = props_->GetProperty("btree.replacement", "clock");
+    buffer::Replacement policy = buffer::Replacement::Clock;
+    if (replacement == "2q") {
+        policy = buffer::Replacement::TwoQ;
+    } else if (replacement == "lruk") {
+        policy = buffer::Replacement::LRUK;
+    } else if (replacement == "lfu") {
+        policy = buffer::Replacement::LFU;
+    } else if (replacement == "cooling") {
+        policy = buffer::Replacement::Cooling;
+    }
+    // write dirty pages back before they are evicted
+    const bool writer = props_->GetProperty("btree.writer", "true") == "true";
+    tree = new btree::BTree<KEY, DATA, PAGE_SIZE>(
+        "/tmp/tree.txt", "/tmp/data.txt", pages, C, X, optimisticReads, ioConfig, policy,
+        buffer::BufferConfig{.backgroundWriter = writer});
+    // evict leaves first, never inner nodes above resident children
+    tree->bufferManager.protectInnerNodes = props_->GetProperty("btree.protectinner", "false") == "true";
 
     if(C){
         tree->d1 = 0.009;
@@ -62,20 +92,27 @@ DB::Status BTreeDB<C, X>::Read(const std::string&, const std::string &k,
 }
 // --------------------------------------------------------------------------
 template <bool C, bool X>
-DB::Status BTreeDB<C, X>::Scan(const std::string &table, const std::string &key, int len,
-            const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
-    return Status::kNotImplemented;
+DB::Status BTreeDB<C, X>::Scan(const std::string&, const std::string &k, int len,
+            const std::vector<std::string>*, std::vector<std::vector<Field>> &result) {
+    KEY key = {};
+    memcpy(key.data(), k.c_str(), std::min(k.length(), key.size()));
+    result.reserve(len);
+    tree->scan(key, len, [&result](const KEY&, const DATA&){
+        result.emplace_back();
+    });
+    return Status::kOK;
 }
 // --------------------------------------------------------------------------
 template <bool C, bool X>
 DB::Status BTreeDB<C, X>::Update(const std::string&, const std::string &k, std::vector<Field> &values) {
     KEY key = {};
     memcpy(key.data(), k.c_str(), std::min(k.length(), key.size()));
-    DATA data = {};
-    size_t offset = 0;
-    for(Field field : values){
-        memcpy(data.data() + offset, field.value.c_str(), field.value.length());
-        offset += field.value.length();
+    DATA data;
+    for(const Field& field : values){
+        data += field.value;
+    }
+    if(data.size() > heap::HeapFile<>::MAX_RECORD_SIZE){
+        return Status::kError;
     }
     bool success = tree->update(key, [&data](DATA& d){
         d = std::move(data);
@@ -90,13 +127,11 @@ template <bool C, bool X>
 DB::Status BTreeDB<C, X>::Insert(const std::string&, const std::string &k, std::vector<Field> &values) {
     KEY key = {};
     memcpy(key.data(), k.c_str(), std::min(k.length(), key.size()));
-    DATA data = {};
-    size_t offset = 0;
+    DATA data;
     for(const Field& field : values){
-        memcpy(data.data() + offset, field.value.c_str(), field.value.length());
-        offset += field.value.length();
+        data += field.value;
     }
-    if(offset > data.size()){
+    if(data.size() > heap::HeapFile<>::MAX_RECORD_SIZE){
         return Status::kError;
     }
     tree->insert(std::move(key), std::move(data));
@@ -104,8 +139,13 @@ DB::Status BTreeDB<C, X>::Insert(const std::string&, const std::string &k, std::
 }
 // --------------------------------------------------------------------------
 template <bool C, bool X>
-DB::Status BTreeDB<C, X>::Delete(const std::string &table, const std::string &key) {
-    return Status::kNotImplemented;
+DB::Status BTreeDB<C, X>::Delete(const std::string&, const std::string &k) {
+    KEY key = {};
+    memcpy(key.data(), k.c_str(), std::min(k.length(), key.size()));
+    if(!tree->erase(key)){
+        return Status::kNotFound;
+    }
+    return Status::kOK;
 }
 // --------------------------------------------------------------------------
 template <bool C, bool X>
@@ -40,6 +40,18 @@ inline int ClientThread(ycsbc::DB *db, ycsbc::CoreWorkload *wl, const int num_op
   return oks;
 }
 
+inline int LoadThread(ycsbc::DB *db, ycsbc::CoreWorkload *wl, uint64_t first_key, const int num_ops,
+                      CountDownLatch *latch) {
+  // every thread inserts its own range of keys
+  int oks = 0;
+  for (int i = 0; i < num_ops; ++i) {
+    oks += wl->DoInsert(*db, first_key + i);
+  }
+
+  latch->CountDown();
+  return oks;
+}
+
 } // ycsbc
 
 #endif // YCSB_C_CLIENT_H_
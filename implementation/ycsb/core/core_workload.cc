@@ -84,6 +84,7 @@ const string CoreWorkload::INSERT_ORDER_DEFAULT = "hashed";
 
 const string CoreWorkload::INSERT_START_PROPERTY = "insertstart";
 const string CoreWorkload::INSERT_START_DEFAULT = "0";
+const string CoreWorkload::INSERT_COUNT_PROPERTY = "insertcount";
 
 const string CoreWorkload::RECORD_COUNT_PROPERTY = "recordcount";
 const string CoreWorkload::OPERATION_COUNT_PROPERTY = "operationcount";
@@ -147,6 +147,12 @@ class CoreWorkload {
   static const std::string INSERT_START_PROPERTY;
   static const std::string INSERT_START_DEFAULT;
 
+  ///
+  /// The name of the property for the number of records to load
+  /// (starting at insertstart). Defaults to the record count.
+  ///
+  static const std::string INSERT_COUNT_PROPERTY;
+
   static const std::string RECORD_COUNT_PROPERTY;
   static const std::string OPERATION_COUNT_PROPERTY;
 
@@ -163,6 +169,11 @@ class CoreWorkload {
   virtual void Init(const utils::Properties &p);
 
   virtual bool DoInsert(DB &db);
+  ///
+  /// Inserts the record with the given key number (used by parallel loads
+  /// with disjoint key ranges).
+  ///
+  virtual bool DoInsert(DB &db, uint64_t key_num);
   virtual bool DoTransaction(DB &db);
 
   bool read_all_fields() const { return read_all_fields_; }
@@ -229,7 +240,11 @@ inline std::string CoreWorkload::NextFieldName() {
 }
 
 inline bool CoreWorkload::DoInsert(DB &db) {
-  const std::string key = BuildKeyName(insert_key_sequence_->Next());
+  return DoInsert(db, insert_key_sequence_->Next());
+}
+
+inline bool CoreWorkload::DoInsert(DB &db, uint64_t key_num) {
+  const std::string key = BuildKeyName(key_num);
   std::vector<DB::Field> fields;
   BuildValues(fields);
   return db.Insert(table_name_, key, fields) == DB::kOK;
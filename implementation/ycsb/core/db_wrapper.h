@@ -32,45 +32,50 @@ class DBWrapper : public DB {
   }
   Status Read(const std::string &table, const std::string &key,
               const std::vector<std::string> *fields, std::vector<Field> &result) {
-    timer_.Start();
+    // every call has its own timer, the wrapper is shared by all client threads
+    utils::Timer<uint64_t, std::nano> timer;
+    timer.Start();
     Status s = db_->Read(table, key, fields, result);
-    uint64_t elapsed = timer_.End();
+    uint64_t elapsed = timer.End();
     measurements_->Report(READ, elapsed);
     return s;
   }
   Status Scan(const std::string &table, const std::string &key, int record_count,
               const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
-    timer_.Start();
+    utils::Timer<uint64_t, std::nano> timer;
+    timer.Start();
     Status s = db_->Scan(table, key, record_count, fields, result);
-    uint64_t elapsed = timer_.End();
+    uint64_t elapsed = timer.End();
     measurements_->Report(SCAN, elapsed);
     return s;
   }
   Status Update(const std::string &table, const std::string &key, std::vector<Field> &values) {
-    timer_.Start();
+    utils::Timer<uint64_t, std::nano> timer;
+    timer.Start();
     Status s = db_->Update(table, key, values);
-    uint64_t elapsed = timer_.End();
+    uint64_t elapsed = timer.End();
     measurements_->Report(UPDATE, elapsed);
     return s;
   }
   Status Insert(const std::string &table, const std::string &key, std::vector<Field> &values) {
-    timer_.Start();
+    utils::Timer<uint64_t, std::nano> timer;
+    timer.Start();
     Status s = db_->Insert(table, key, values);
-    uint64_t elapsed = timer_.End();
+    uint64_t elapsed = timer.End();
     measurements_->Report(INSERT, elapsed);
     return s;
   }
   Status Delete(const std::string &table, const std::string &key) {
-    timer_.Start();
+    utils::Timer<uint64_t, std::nano> timer;
+    timer.Start();
     Status s = db_->Delete(table, key);
-    uint64_t elapsed = timer_.End();
+    uint64_t elapsed = timer.End();
     measurements_->Report(DELETE, elapsed);
     return s;
   }
  public:
   DB *db_;
   Measurements *measurements_;
-  utils::Timer<uint64_t, std::nano> timer_;
 };
 
 } // ycsbc
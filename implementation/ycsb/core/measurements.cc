@@ -7,57 +7,196 @@
 
 #include "measurements.h"
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <cmath>
 #include <limits>
 #include <numeric>
 #include <sstream>
 
 namespace ycsbc {
 
-Measurements::Measurements() : count_{}, latency_sum_{}, latency_max_{} {
-  std::fill(std::begin(latency_min_), std::end(latency_min_), std::numeric_limits<uint64_t>::max());
+size_t Histogram::BucketIndex(uint64_t value) {
+  if (value < 2 * kSubBuckets) {
+    return value;
+  }
+  // keep the kSubBucketBits bits below the highest set bit
+  const int shift = std::bit_width(value) - kSubBucketBits - 1;
+  return shift * kSubBuckets + (value >> shift);
+}
+
+uint64_t Histogram::BucketValue(size_t index) {
+  if (index < 2 * kSubBuckets) {
+    return index;
+  }
+  const int shift = index / kSubBuckets - 1;
+  const uint64_t mantissa = index % kSubBuckets + kSubBuckets;
+  return (mantissa << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+Histogram::Histogram() {
+  Reset();
+}
+
+void Histogram::Record(uint64_t value) {
+  // there is only one writer, so no read-modify-write instructions are needed
+  auto increment = [](std::atomic<uint64_t> &counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  };
+  increment(buckets[BucketIndex(value)], 1);
+  increment(count, 1);
+  increment(sum, value);
+  if (value < min.load(std::memory_order_relaxed)) {
+    min.store(value, std::memory_order_relaxed);
+  }
+  if (value > max.load(std::memory_order_relaxed)) {
+    max.store(value, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::Reset() {
+  count.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+  min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+  for (auto &bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+namespace {
+
+std::atomic<uint64_t> next_measurements_id{0};
+
+// percentiles printed in the status and summary messages
+const struct {
+  double percentile;
+  const char *label;
+} kPercentiles[] = {{50.0, "P50"}, {90.0, "P90"}, {99.0, "P99"}, {99.9, "P99.9"}, {99.99, "P99.99"}};
+
+} // namespace
+
+Measurements::Measurements() : id_(next_measurements_id.fetch_add(1)) {}
+
+Measurements::ThreadHistograms &Measurements::LocalHistograms() {
+  thread_local uint64_t cached_id = std::numeric_limits<uint64_t>::max();
+  thread_local ThreadHistograms *cached = nullptr;
+  if (cached_id != id_) {
+    auto histograms = std::make_unique<ThreadHistograms>();
+    cached = histograms.get();
+    cached_id = id_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(std::move(histograms));
+  }
+  return *cached;
 }
 
 void Measurements::Report(Operation op, uint64_t latency) {
-  count_[op].fetch_add(1, std::memory_order_relaxed);
-  latency_sum_[op].fetch_add(latency, std::memory_order_relaxed);
-  uint64_t prev_min = latency_min_[op].load(std::memory_order_relaxed);
-  while (prev_min > latency
-         && !latency_min_[op].compare_exchange_weak(prev_min, latency, std::memory_order_relaxed));
-  uint64_t prev_max = latency_max_[op].load(std::memory_order_relaxed);
-  while (prev_max < latency
-         && !latency_max_[op].compare_exchange_weak(prev_max, latency, std::memory_order_relaxed));
+  LocalHistograms().ops[op].Record(latency);
 }
 
-std::string Measurements::GetStatusMsg() {
+Measurements::Snapshot Measurements::Merge(Operation op) {
+  Snapshot snapshot;
+  snapshot.min = std::numeric_limits<uint64_t>::max();
+  snapshot.buckets.resize(Histogram::kBuckets);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &thread : threads_) {
+    const Histogram &histogram = thread->ops[op];
+    snapshot.count += histogram.count.load(std::memory_order_relaxed);
+    snapshot.sum += histogram.sum.load(std::memory_order_relaxed);
+    snapshot.min = std::min(snapshot.min, histogram.min.load(std::memory_order_relaxed));
+    snapshot.max = std::max(snapshot.max, histogram.max.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < Histogram::kBuckets; i++) {
+      snapshot.buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+    }
+  }
+  if (snapshot.count == 0) {
+    snapshot.min = 0;
+  }
+  return snapshot;
+}
+
+uint64_t Measurements::Snapshot::Percentile(double percentile) const {
+  // the buckets are read one after another, so their total may differ from count
+  const uint64_t total = std::accumulate(buckets.begin(), buckets.end(), uint64_t{0});
+  if (total == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(1, std::ceil(percentile / 100.0 * total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // the recorded extremes are exact
+      return std::clamp(Histogram::BucketValue(i), min, max);
+    }
+  }
+  return max;
+}
+
+uint64_t Measurements::GetCount(Operation op) {
+  return Merge(op).count;
+}
+
+double Measurements::GetLatency(Operation op) {
+  const Snapshot snapshot = Merge(op);
+  return snapshot.count > 0 ? static_cast<double>(snapshot.sum) / snapshot.count : 0.0;
+}
+
+uint64_t Measurements::GetPercentile(Operation op, double percentile) {
+  return Merge(op).Percentile(percentile);
+}
+
+std::string Measurements::OperationMsg(Operation op, const Snapshot &snapshot) {
   std::ostringstream msg_stream;
   msg_stream.precision(2);
+  msg_stream << std::fixed << kOperationString[op] << ":"
+             << " Count=" << snapshot.count
+             << " Max=" << snapshot.max / 1000.0
+             << " Min=" << snapshot.min / 1000.0
+             << " Avg=" << static_cast<double>(snapshot.sum) / snapshot.count / 1000.0;
+  for (const auto &[percentile, label] : kPercentiles) {
+    msg_stream << " " << label << "=" << snapshot.Percentile(percentile) / 1000.0;
+  }
+  return msg_stream.str();
+}
+
+std::string Measurements::GetStatusMsg() {
+  std::ostringstream msg_stream;
   uint64_t total_cnt = 0;
-  msg_stream << std::fixed << " operations;";
+  msg_stream << " operations;";
   for (int i = 0; i < MAXOPTYPE; i++) {
     Operation op = static_cast<Operation>(i);
-    uint64_t cnt = GetCount(op);
-    if (cnt == 0)
+    const Snapshot snapshot = Merge(op);
+    if (snapshot.count == 0)
       continue;
-    msg_stream << " [" << kOperationString[op] << ":"
-               << " Count=" << cnt
-               << " Max=" << latency_max_[op].load(std::memory_order_relaxed) / 1000.0
-               << " Min=" << latency_min_[op].load(std::memory_order_relaxed) / 1000.0
-               << " Avg="
-               << ((cnt > 0)
-                   ? static_cast<double>(latency_sum_[op].load(std::memory_order_relaxed)) / cnt
-                   : 0) / 1000.0
-               << "]";
-    total_cnt += cnt;
+    msg_stream << " [" << OperationMsg(op, snapshot) << "]";
+    total_cnt += snapshot.count;
   }
   return std::to_string(total_cnt) + msg_stream.str();
 }
 
+std::string Measurements::GetSummaryMsg() {
+  std::ostringstream msg_stream;
+  msg_stream << "Latency(us):";
+  for (int i = 0; i < MAXOPTYPE; i++) {
+    Operation op = static_cast<Operation>(i);
+    const Snapshot snapshot = Merge(op);
+    if (snapshot.count == 0)
+      continue;
+    msg_stream << "\n  " << OperationMsg(op, snapshot);
+  }
+  return msg_stream.str();
+}
+
 void Measurements::Reset() {
-  std::fill(std::begin(count_), std::end(count_), 0);
-  std::fill(std::begin(latency_sum_), std::end(latency_sum_), 0);
-  std::fill(std::begin(latency_min_), std::end(latency_min_), std::numeric_limits<uint64_t>::max());
-  std::fill(std::begin(latency_max_), std::end(latency_max_), 0);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &thread : threads_) {
+    for (auto &histogram : thread->ops) {
+      histogram.Reset();
+    }
+  }
 }
 
 } // ycsbc
@@ -11,29 +11,74 @@
 #include "core_workload.h"
 
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace ycsbc {
 
+// log-linear latency histogram: values below 2 * kSubBuckets are counted
+// exactly, larger ones in kSubBuckets buckets per power of two (relative
+// error below 1 / kSubBuckets); written by a single thread only
+class Histogram {
+ public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  static constexpr size_t kBuckets = (65 - kSubBucketBits) * kSubBuckets;
+
+  static size_t BucketIndex(uint64_t value);
+  // highest value which is counted in the bucket
+  static uint64_t BucketValue(size_t index);
+
+  Histogram();
+  void Record(uint64_t value);
+  void Reset();
+
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> min;
+  std::atomic<uint64_t> max;
+  std::atomic<uint64_t> buckets[kBuckets];
+};
+
 class Measurements {
  public:
   Measurements();
   void Report(Operation op, uint64_t latency);
-  uint64_t GetCount(Operation op) {
-    return count_[op].load(std::memory_order_relaxed);
-  }
-  double GetLatency(Operation op) {
-    uint64_t cnt = GetCount(op);
-    return cnt > 0
-        ? static_cast<double>(latency_sum_[op].load(std::memory_order_relaxed)) / cnt
-        : 0.0;
-  }
+  uint64_t GetCount(Operation op);
+  double GetLatency(Operation op);
+  // latency (in ns) below which the given percentage of the operations completed
+  uint64_t GetPercentile(Operation op, double percentile);
   std::string GetStatusMsg();
+  // one line per operation
+  std::string GetSummaryMsg();
+  // must not run concurrently with Report
   void Reset();
  private:
-  std::atomic<uint> count_[MAXOPTYPE];
-  std::atomic<uint64_t> latency_sum_[MAXOPTYPE];
-  std::atomic<uint64_t> latency_min_[MAXOPTYPE];
-  std::atomic<uint64_t> latency_max_[MAXOPTYPE];
+  // the histograms of all threads, merged
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+    uint64_t Percentile(double percentile) const;
+  };
+  // every reporting thread gets its own histograms, so that Report does not
+  // share any cache lines between threads
+  struct ThreadHistograms {
+    Histogram ops[MAXOPTYPE];
+  };
+
+  ThreadHistograms &LocalHistograms();
+  Snapshot Merge(Operation op);
+  std::string OperationMsg(Operation op, const Snapshot &snapshot);
+
+  // distinguishes instances in the thread local cache
+  const uint64_t id_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadHistograms>> threads_;
 };
 
 } // ycsbc
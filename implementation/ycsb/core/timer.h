@@ -31,7 +31,8 @@ class Timer {
 
  private:
   using Duration = std::chrono::duration<R, P>;
-  using Clock = std::chrono::high_resolution_clock;
+  // monotonic, unlike high_resolution_clock which may be the system clock
+  using Clock = std::chrono::steady_clock;
 
   Clock::time_point time_;
 };
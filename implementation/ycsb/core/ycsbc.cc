@@ -85,29 +85,47 @@ int main(const int argc, const char* argv[]) {
     const bool show_status = (props.GetProperty("status", "false") == "true");
     const int status_interval = std::stoi(props.GetProperty("status.interval", "10"));
 
+    // the database is shared by all client threads (initializing it in every
+    // thread would recreate it)
+    db->Init();
+
     // load phase
     if (do_load) {
         std::cout << "Loading..." << std::endl;
-        const int total_ops = stoi(props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]);
+        const uint64_t insert_start = std::stoull(props.GetProperty(ycsbc::CoreWorkload::INSERT_START_PROPERTY,
+                                                                    ycsbc::CoreWorkload::INSERT_START_DEFAULT));
+        const int total_ops = stoi(props.GetProperty(ycsbc::CoreWorkload::INSERT_COUNT_PROPERTY,
+                                                     props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]));
 
-        CountDownLatch latch(1);
+        CountDownLatch latch(num_threads);
+        ycsbc::utils::Timer<double> timer;
 
+        timer.Start();
+        // disjoint key ranges per thread
         std::vector<std::future<int>> client_threads;
-        for (int i = 0; i < 1; ++i) {
-            int thread_ops = total_ops / 1;
-            if (i < total_ops % 1) {
+        uint64_t first_key = insert_start;
+        for (int i = 0; i < num_threads; ++i) {
+            int thread_ops = total_ops / num_threads;
+            if (i < total_ops % num_threads) {
                 thread_ops++;
             }
-            client_threads.emplace_back(std::async(std::launch::async, ycsbc::ClientThread, db, &wl,
-                                                   total_ops, true, true, !do_transaction, &latch));
+            client_threads.emplace_back(std::async(std::launch::async, ycsbc::LoadThread, db, &wl,
+                                                   first_key, thread_ops, &latch));
+            first_key += thread_ops;
         }
         int sum = 0;
         for (auto& n : client_threads) {
             assert(n.valid());
             sum += n.get();
         }
+        double runtime = timer.End();
 
         std::cout << "Loaded " << sum << " entries." << std::endl;
+        std::cout << "Load runtime(sec): " << runtime << std::endl;
+        std::cout << "Load operations(ops): " << sum << std::endl;
+        std::cout << "Load throughput(ops/sec): " << sum / runtime << std::endl;
+        std::cout << measurements.GetSummaryMsg() << "\n"
+                  << std::endl;
     }
 
     auto* wrapper = dynamic_cast<ycsbc::DBWrapper*>(db)->db_;
@@ -136,7 +154,7 @@ int main(const int argc, const char* argv[]) {
                 thread_ops++;
             }
             client_threads.emplace_back(std::async(std::launch::async, ycsbc::ClientThread, db, &wl,
-                                                   thread_ops, false, !do_load, true, &latch));
+                                                   thread_ops, false, false, false, &latch));
         }
         assert((int) client_threads.size() == num_threads);
 
@@ -153,43 +171,90 @@ int main(const int argc, const char* argv[]) {
 
         std::cout << "Run runtime(sec): " << runtime << std::endl;
         std::cout << "Run operations(ops): " << sum << std::endl;
-        std::cout << "Run throughput(ops/sec): " << sum / runtime << "\n"
+        std::cout << "Run throughput(ops/sec): " << sum / runtime << std::endl;
+        std::cout << measurements.GetSummaryMsg() << "\n"
                   << std::endl;
         auto dbName = props["dbname"];
         if (dbName == "btree_none") {
             auto* ptr = dynamic_cast<ycsbc::BTreeDB<false, false>*>(wrapper);
             std::cout << "Page Evictions: " << ptr->tree->bufferManager.SWAPS << std::endl;
             std::cout << "Contention Splits: " << ptr->tree->CONTENTION_SPLITS << std::endl;
+            std::cout << "Optimistic Restarts: " << ptr->tree->OPTIMISTIC_RESTARTS << std::endl;
             std::cout << "X-Merges: " << ptr->tree->bufferManager.SPECIAL_LOADS << std::endl;
-            std::cout << "Keys per Node: " << ptr->tree->KEYS_PER_NODE << std::endl;
+            std::cout << "Page Misses: " << ptr->tree->bufferManager.MISSES << std::endl;
+            std::cout << "Inner Node Misses: " << ptr->tree->bufferManager.INNER_MISSES << std::endl;
+            std::cout << "Pin Waits: " << ptr->tree->bufferManager.PIN_WAITS + ptr->tree->heapFile->bufferManager.PIN_WAITS
+                      << std::endl;
+            std::cout << "Background Writes: "
+                      << ptr->tree->bufferManager.BACKGROUND_WRITES + ptr->tree->heapFile->bufferManager.BACKGROUND_WRITES
+                      << std::endl;
+            std::cout << "Keys per Leaf: " << ptr->tree->KEYS_PER_LEAF << std::endl;
+            std::cout << "Keys per Inner Node: " << ptr->tree->KEYS_PER_INNER_NODE << std::endl;
             std::cout << "Tree Size: " << std::filesystem::file_size("/tmp/tree.txt") << std::endl;
             std::cout << "Nodes: " << ptr->tree->bufferManager.totalFrames() << std::endl;
+            std::cout << "Heap Pages: " << ptr->tree->heapFile->pageAmount() << std::endl;
+            std::cout << "Heap Evictions: " << ptr->tree->heapFile->bufferManager.SWAPS << std::endl;
         } else if (dbName == "btree_both") {
             auto* ptr = dynamic_cast<ycsbc::BTreeDB<true, true>*>(wrapper);
             std::cout << "Page Evictions: " << ptr->tree->bufferManager.SWAPS << std::endl;
             std::cout << "Contention Splits: " << ptr->tree->CONTENTION_SPLITS << std::endl;
+            std::cout << "Optimistic Restarts: " << ptr->tree->OPTIMISTIC_RESTARTS << std::endl;
             std::cout << "X-Merges: " << ptr->tree->bufferManager.SPECIAL_LOADS << std::endl;
-            std::cout << "Keys per Node: " << ptr->tree->KEYS_PER_NODE << std::endl;
+            std::cout << "Page Misses: " << ptr->tree->bufferManager.MISSES << std::endl;
+            std::cout << "Inner Node Misses: " << ptr->tree->bufferManager.INNER_MISSES << std::endl;
+            std::cout << "Pin Waits: " << ptr->tree->bufferManager.PIN_WAITS + ptr->tree->heapFile->bufferManager.PIN_WAITS
+                      << std::endl;
+            std::cout << "Background Writes: "
+                      << ptr->tree->bufferManager.BACKGROUND_WRITES + ptr->tree->heapFile->bufferManager.BACKGROUND_WRITES
+                      << std::endl;
+            std::cout << "Keys per Leaf: " << ptr->tree->KEYS_PER_LEAF << std::endl;
+            std::cout << "Keys per Inner Node: " << ptr->tree->KEYS_PER_INNER_NODE << std::endl;
             std::cout << "Tree Size: " << std::filesystem::file_size("/tmp/tree.txt") << std::endl;
             std::cout << "Nodes: " << ptr->tree->bufferManager.totalFrames() << std::endl;
+            std::cout << "Heap Pages: " << ptr->tree->heapFile->pageAmount() << std::endl;
+            std::cout << "Heap Evictions: " << ptr->tree->heapFile->bufferManager.SWAPS << std::endl;
         } else if (dbName == "btree_x") {
             auto* ptr = dynamic_cast<ycsbc::BTreeDB<false, true>*>(wrapper);
             std::cout << "Page Evictions: " << ptr->tree->bufferManager.SWAPS << std::endl;
             std::cout << "Contention Splits: " << ptr->tree->CONTENTION_SPLITS << std::endl;
+            std::cout << "Optimistic Restarts: " << ptr->tree->OPTIMISTIC_RESTARTS << std::endl;
             std::cout << "X-Merges: " << ptr->tree->bufferManager.SPECIAL_LOADS << std::endl;
-            std::cout << "Keys per Node: " << ptr->tree->KEYS_PER_NODE << std::endl;
+            std::cout << "Page Misses: " << ptr->tree->bufferManager.MISSES << std::endl;
+            std::cout << "Inner Node Misses: " << ptr->tree->bufferManager.INNER_MISSES << std::endl;
+            std::cout << "Pin Waits: " << ptr->tree->bufferManager.PIN_WAITS + ptr->tree->heapFile->bufferManager.PIN_WAITS
+                      << std::endl;
+            std::cout << "Background Writes: "
+                      << ptr->tree->bufferManager.BACKGROUND_WRITES + ptr->tree->heapFile->bufferManager.BACKGROUND_WRITES
+                      << std::endl;
+            std::cout << "Keys per Leaf: " << ptr->tree->KEYS_PER_LEAF << std::endl;
+            std::cout << "Keys per Inner Node: " << ptr->tree->KEYS_PER_INNER_NODE << std::endl;
             std::cout << "Tree Size: " << std::filesystem::file_size("/tmp/tree.txt") << std::endl;
             std::cout << "Nodes: " << ptr->tree->bufferManager.totalFrames() << std::endl;
+            std::cout << "Heap Pages: " << ptr->tree->heapFile->pageAmount() << std::endl;
+            std::cout << "Heap Evictions: " << ptr->tree->heapFile->bufferManager.SWAPS << std::endl;
         } else if (dbName == "btree_c") {
             auto* ptr = dynamic_cast<ycsbc::BTreeDB<true, false>*>(wrapper);
             std::cout << "Page Evictions: " << ptr->tree->bufferManager.SWAPS << std::endl;
             std::cout << "Contention Splits: " << ptr->tree->CONTENTION_SPLITS << std::endl;
+            std::cout << "Optimistic Restarts: " << ptr->tree->OPTIMISTIC_RESTARTS << std::endl;
             std::cout << "X-Merges: " << ptr->tree->bufferManager.SPECIAL_LOADS << std::endl;
-            std::cout << "Keys per Node: " << ptr->tree->KEYS_PER_NODE << std::endl;
+            std::cout << "Page Misses: " << ptr->tree->bufferManager.MISSES << std::endl;
+            std::cout << "Inner Node Misses: " << ptr->tree->bufferManager.INNER_MISSES << std::endl;
+            std::cout << "Pin Waits: " << ptr->tree->bufferManager.PIN_WAITS + ptr->tree->heapFile->bufferManager.PIN_WAITS
+                      << std::endl;
+            std::cout << "Background Writes: "
+                      << ptr->tree->bufferManager.BACKGROUND_WRITES + ptr->tree->heapFile->bufferManager.BACKGROUND_WRITES
+                      << std::endl;
+            std::cout << "Keys per Leaf: " << ptr->tree->KEYS_PER_LEAF << std::endl;
+            std::cout << "Keys per Inner Node: " << ptr->tree->KEYS_PER_INNER_NODE << std::endl;
             std::cout << "Tree Size: " << std::filesystem::file_size("/tmp/tree.txt") << std::endl;
             std::cout << "Nodes: " << ptr->tree->bufferManager.totalFrames() << std::endl;
+            std::cout << "Heap Pages: " << ptr->tree->heapFile->pageAmount() << std::endl;
+            std::cout << "Heap Evictions: " << ptr->tree->heapFile->bufferManager.SWAPS << std::endl;
         }
     }
+
+    db->Cleanup();
 }
 
 void ParseCommandLine(int argc, const char* argv[], ycsbc::utils::Properties& props) {